@@ -0,0 +1,262 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "../slitherlink/sl_dictionary.h"
+#include "../slitherlink/sl_generator.h"
+#include "../slitherlink/sl_generator_option.h"
+#include "../slitherlink/sl_clue_placement.h"
+#include "../nurikabe/nk_generator.h"
+#include "../masyu/ms_generator.h"
+#include "../kakuro/kk_generator.h"
+#include "../kakuro/kk_dictionary.h"
+
+namespace
+{
+using namespace penciloid;
+
+const int kMaxAttemptsPerProblem = 50;
+
+void ShowUsage(int argc, char** argv)
+{
+	std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
+	std::cerr << "Options:\n\
+  --help         Display this information\n\
+  -n <num>       Generate <num> problems for each workload (default: 10)\n\
+  -s <seed>      Set the seed of the workloads (default: 0)\n\
+  -f <filter>    Run only the workloads whose names contain <filter>\n\
+  -l             List the workloads and exit\n\
+  --json         Output the results as JSON lines instead of CSV\n\
+\n\
+Each problem is generated by repeated attempts (calls of GenerateByLocalSearch) until one succeeds.\n\
+A problem is given up after " << kMaxAttemptsPerProblem << " failed attempts." << std::endl;
+}
+
+// One attempt to generate a problem. Returns true on success.
+typedef std::function<bool(std::mt19937 *)> Attempt;
+
+struct Workload
+{
+	std::string name;
+	int height, width;
+	double clue_density; // only for the puzzles with clue placements; negative otherwise
+	Attempt attempt;
+};
+
+struct Result
+{
+	int n_problems, n_failed_problems;
+	long long n_attempts, n_successful_attempts;
+	double total_seconds;
+	std::vector<double> problem_seconds; // time to each successful problem, including failed attempts before it
+};
+
+Grid<bool> KakuroClueLayout(int height, int width)
+{
+	// The first row and column, and a diagonal pattern of blocks which keeps every run at most 4 cells long
+	Grid<bool> ret(Y(height), X(width), false);
+	for (Y y(0); y < height; ++y) {
+		for (X x(0); x < width; ++x) {
+			int yi = static_cast<int>(y), xi = static_cast<int>(x);
+			if (yi == 0 || xi == 0 || (yi + 2 * xi) % 5 == 0) ret(y, x) = true;
+		}
+	}
+	return ret;
+}
+
+std::vector<Workload> MakeWorkloads(slitherlink::Dictionary *sl_dic, kakuro::Dictionary *kk_dic)
+{
+	std::vector<Workload> ret;
+
+	const int sl_sizes[][2] = { { 10, 10 }, { 16, 16 }, { 20, 20 } };
+	const double sl_densities[] = { 0.3, 0.4 };
+	for (auto &size : sl_sizes) {
+		for (double density : sl_densities) {
+			int height = size[0], width = size[1];
+			std::ostringstream name;
+			name << "slitherlink/" << height << "x" << width << "/d" << density;
+			ret.push_back({ name.str(), height, width, density, [=](std::mt19937 *rnd) {
+				slitherlink::GeneratorOption opt;
+				opt.field_dictionary = sl_dic;
+				int n_clues = static_cast<int>(height * width * density);
+				slitherlink::CluePlacement placement = slitherlink::GenerateCluePlacement(Y(height), X(width), n_clues, 0, rnd);
+				slitherlink::Problem problem;
+				return slitherlink::GenerateByLocalSearch(placement, opt, rnd, &problem);
+			} });
+		}
+	}
+
+	const int nk_sizes[] = { 6, 8 };
+	for (int size : nk_sizes) {
+		std::ostringstream name;
+		name << "nurikabe/" << size << "x" << size;
+		ret.push_back({ name.str(), size, size, -1.0, [=](std::mt19937 *rnd) {
+			nurikabe::Problem problem;
+			return nurikabe::GenerateByLocalSearch(Y(size), X(size), rnd, &problem);
+		} });
+	}
+
+	const int ms_sizes[] = { 8, 10, 16 };
+	for (int size : ms_sizes) {
+		std::ostringstream name;
+		name << "masyu/" << size << "x" << size;
+		ret.push_back({ name.str(), size, size, -1.0, [=](std::mt19937 *rnd) {
+			masyu::Problem problem;
+			return masyu::GenerateByLocalSearch(Y(size), X(size), rnd, &problem);
+		} });
+	}
+
+	const int kk_sizes[] = { 9, 13 };
+	for (int size : kk_sizes) {
+		std::ostringstream name;
+		name << "kakuro/" << size << "x" << size;
+		Grid<bool> layout = KakuroClueLayout(size, size);
+		ret.push_back({ name.str(), size, size, -1.0, [=](std::mt19937 *rnd) {
+			kakuro::Problem problem;
+			return kakuro::GenerateByLocalSearch(layout, kk_dic, rnd, &problem);
+		} });
+	}
+
+	return ret;
+}
+
+Result RunWorkload(const Workload &workload, int n_problems, unsigned int seed)
+{
+	typedef std::chrono::steady_clock Clock;
+	Result ret = { 0, 0, 0, 0, 0.0, {} };
+
+	for (int i = 0; i < n_problems; ++i) {
+		// Every problem has its own stream derived from the name of the workload, so that adding workloads doesn't change the others
+		std::vector<unsigned int> seq_base(workload.name.begin(), workload.name.end());
+		seq_base.push_back(seed);
+		seq_base.push_back(static_cast<unsigned int>(i));
+		std::seed_seq seq(seq_base.begin(), seq_base.end());
+		std::mt19937 rnd(seq);
+
+		Clock::time_point start = Clock::now();
+		bool success = false;
+		for (int attempt = 0; attempt < kMaxAttemptsPerProblem && !success; ++attempt) {
+			++ret.n_attempts;
+			success = workload.attempt(&rnd);
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		++ret.n_problems;
+		ret.total_seconds += seconds;
+		if (success) {
+			++ret.n_successful_attempts;
+			ret.problem_seconds.push_back(seconds);
+		} else {
+			++ret.n_failed_problems;
+		}
+	}
+	std::sort(ret.problem_seconds.begin(), ret.problem_seconds.end());
+	return ret;
+}
+
+double Percentile(const std::vector<double> &sorted, double p)
+{
+	if (sorted.empty()) return 0.0;
+	int idx = static_cast<int>(p * (sorted.size() - 1) + 0.5);
+	return sorted[idx];
+}
+
+void PrintResult(const Workload &workload, const Result &result, bool json)
+{
+	int n_solved = result.n_problems - result.n_failed_problems;
+	double problems_per_sec = result.total_seconds > 0.0 ? n_solved / result.total_seconds : 0.0;
+	double mean = 0.0;
+	for (double t : result.problem_seconds) mean += t;
+	if (n_solved > 0) mean /= n_solved;
+	double success_rate = result.n_attempts > 0 ? static_cast<double>(result.n_successful_attempts) / result.n_attempts : 0.0;
+	double attempts_per_problem = n_solved > 0 ? static_cast<double>(result.n_attempts) / n_solved : 0.0;
+	double p50 = Percentile(result.problem_seconds, 0.5), p99 = Percentile(result.problem_seconds, 0.99);
+
+	if (json) {
+		std::cout << "{\"workload\":\"" << workload.name << "\""
+			<< ",\"height\":" << workload.height << ",\"width\":" << workload.width;
+		if (workload.clue_density >= 0.0) std::cout << ",\"clue_density\":" << workload.clue_density;
+		std::cout << ",\"problems\":" << result.n_problems
+			<< ",\"failed_problems\":" << result.n_failed_problems
+			<< ",\"attempts\":" << result.n_attempts
+			<< ",\"problems_per_sec\":" << problems_per_sec
+			<< ",\"mean_sec\":" << mean
+			<< ",\"p50_sec\":" << p50
+			<< ",\"p99_sec\":" << p99
+			<< ",\"attempt_success_rate\":" << success_rate
+			<< ",\"attempts_per_problem\":" << attempts_per_problem
+			<< "}" << std::endl;
+	} else {
+		std::cout << workload.name << "," << workload.height << "," << workload.width << ",";
+		if (workload.clue_density >= 0.0) std::cout << workload.clue_density;
+		std::cout << "," << result.n_problems << "," << result.n_failed_problems << "," << result.n_attempts
+			<< "," << problems_per_sec << "," << mean << "," << p50 << "," << p99
+			<< "," << success_rate << "," << attempts_per_problem << std::endl;
+	}
+}
+}
+
+int main(int argc, char** argv)
+{
+	int n_problems = 10;
+	unsigned int seed = 0;
+	std::string filter = "";
+	bool list_only = false;
+	bool json = false;
+
+	for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+		std::string opt = argv[arg_idx];
+		if (opt == "--help") {
+			ShowUsage(argc, argv);
+			return 0;
+		} else if (opt == "--json") {
+			json = true;
+		} else if (opt == "-l") {
+			list_only = true;
+		} else if (opt == "-n" || opt == "-s" || opt == "-f") {
+			if (arg_idx + 1 >= argc) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+			std::istringstream iss(argv[++arg_idx]);
+			if (opt == "-n") iss >> n_problems;
+			else if (opt == "-s") iss >> seed;
+			else iss >> filter;
+			if (iss.fail()) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+		} else {
+			std::cerr << "error: unrecognized option '" << opt << "'" << std::endl;
+			return 0;
+		}
+	}
+
+	slitherlink::Dictionary sl_dic;
+	sl_dic.CreateDefault();
+	kakuro::Dictionary kk_dic;
+	kk_dic.CreateDefault();
+
+	std::vector<Workload> workloads = MakeWorkloads(&sl_dic, &kk_dic);
+
+	if (list_only) {
+		for (Workload &w : workloads) std::cout << w.name << std::endl;
+		return 0;
+	}
+
+	if (!json) {
+		std::cout << "workload,height,width,clue_density,problems,failed_problems,attempts,problems_per_sec,mean_sec,p50_sec,p99_sec,attempt_success_rate,attempts_per_problem" << std::endl;
+	}
+	for (std::size_t i = 0; i < workloads.size(); ++i) {
+		if (workloads[i].name.find(filter) == std::string::npos) continue;
+		std::cerr << "running " << workloads[i].name << "..." << std::endl;
+		Result result = RunWorkload(workloads[i], n_problems, seed);
+		PrintResult(workloads[i], result, json);
+	}
+	return 0;
+}
\ No newline at end of file
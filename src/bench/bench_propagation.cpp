@@ -0,0 +1,334 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "../common/grid_loop.h"
+#include "../common/grid_loop_helper.h"
+#include "../common/grid_loop_stats.h"
+#include "../slitherlink/sl_dictionary.h"
+#include "../slitherlink/sl_field.h"
+#include "../slitherlink/sl_bitboard_field.h"
+#include "../slitherlink/sl_generator.h"
+#include "../slitherlink/sl_generator_option.h"
+#include "../slitherlink/sl_clue_placement.h"
+#include "../slitherlink/sl_problem.h"
+
+namespace
+{
+using namespace penciloid;
+using namespace slitherlink;
+
+typedef std::chrono::steady_clock Clock;
+
+void ShowUsage(int argc, char** argv)
+{
+	std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
+	std::cerr << "Options:\n\
+  --help         Display this information\n\
+  -n <num>       Use <num> problems of each size as the corpus (default: 3)\n\
+  -r <num>       Repeat each case <num> times on every problem (default: 20)\n\
+  -s <seed>      Set the seed of the corpus (default: 0)\n\
+  -f <filter>    Run only the cases whose names contain <filter>\n\
+  --json         Output the results as JSON lines instead of CSV\n\
+  --rules        Print the statistics of each deduction rule to stderr\n\
+  --pair-table   Use the pair table of the dictionary in the cases\n\
+\n\
+The corpus consists of problems generated with the fixed seed.\n\
+Operation counters are reported only if the benchmark is built with PENCILOID_GRID_LOOP_STATS." << std::endl;
+}
+
+struct CorpusEntry
+{
+	Problem problem;
+	Field solved; // the field made from <problem>
+	std::vector<CellPosition> clue_order;
+	std::vector<std::pair<LoopPosition, PlainGridLoop::EdgeState> > solution_edges;
+};
+
+// A case runs one operation on <entry> and returns the time spent on the part to be measured.
+typedef std::function<Clock::duration(const CorpusEntry &)> Case;
+
+std::vector<CorpusEntry> MakeCorpus(Dictionary *dic, int n_problems, unsigned int seed)
+{
+	const int sizes[][2] = { { 10, 10 }, { 16, 16 }, { 20, 20 } };
+	std::vector<CorpusEntry> ret;
+
+	for (auto &size : sizes) {
+		int height = size[0], width = size[1];
+		for (int i = 0; i < n_problems; ++i) {
+			std::seed_seq seq{ seed, static_cast<unsigned int>(height), static_cast<unsigned int>(width), static_cast<unsigned int>(i) };
+			std::mt19937 rnd(seq);
+
+			GeneratorOption opt;
+			opt.field_dictionary = dic;
+			CorpusEntry entry;
+			for (;;) {
+				CluePlacement placement = GenerateCluePlacement(Y(height), X(width), static_cast<int>(height * width * 0.4), 0, &rnd);
+				if (GenerateByLocalSearch(placement, opt, &rnd, &entry.problem)) break;
+			}
+			entry.solved = Field(entry.problem, dic);
+
+			for (Y y(0); y < height; ++y) {
+				for (X x(0); x < width; ++x) {
+					if (entry.problem.GetClue(CellPosition(y, x)) != kNoClue) entry.clue_order.push_back(CellPosition(y, x));
+				}
+			}
+			std::shuffle(entry.clue_order.begin(), entry.clue_order.end(), rnd);
+
+			for (Y y(0); y <= 2 * height; ++y) {
+				for (X x(0); x <= 2 * width; ++x) {
+					if (static_cast<int>(y % 2) != static_cast<int>(x % 2)) {
+						entry.solution_edges.push_back({ LoopPosition(y, x), static_cast<PlainGridLoop::EdgeState>(entry.solved.GetEdge(LoopPosition(y, x))) });
+					}
+				}
+			}
+			std::shuffle(entry.solution_edges.begin(), entry.solution_edges.end(), rnd);
+
+			ret.push_back(std::move(entry));
+		}
+	}
+	return ret;
+}
+
+std::vector<std::pair<std::string, Case> > MakeCases(Dictionary *dic)
+{
+	std::vector<std::pair<std::string, Case> > ret;
+
+	// Field construction from a problem: all the clues are added in one queued run
+	ret.push_back({ "construct", [dic](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		Field field(entry.problem, dic);
+		return Clock::now() - start;
+	} });
+
+	// Only the local rules applied on the bitboards
+	ret.push_back({ "bitboard", [](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		BitboardField field(entry.problem);
+		field.Propagate();
+		return Clock::now() - start;
+	} });
+
+	// The same as construct, but the field starts from the result of the bitboards
+	ret.push_back({ "bitboard_construct", [dic](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		BitboardField bitboard(entry.problem);
+		bitboard.Propagate();
+		Field field(entry.problem.height(), entry.problem.width(), dic);
+		field.QueuedRun([&]() {
+			bitboard.ApplyTo(&field);
+			for (Y y(0); y < entry.problem.height(); ++y) {
+				for (X x(0); x < entry.problem.width(); ++x) {
+					if (entry.problem.GetClue(CellPosition(y, x)) != kNoClue) field.AddClue(CellPosition(y, x), entry.problem.GetClue(CellPosition(y, x)));
+				}
+			}
+		});
+		return Clock::now() - start;
+	} });
+
+	// The clues are added one by one in a random order, with propagation after each of them
+	ret.push_back({ "replay_clues", [dic](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		Field field(entry.problem.height(), entry.problem.width(), dic);
+		for (CellPosition pos : entry.clue_order) field.AddClue(pos, entry.problem.GetClue(pos));
+		return Clock::now() - start;
+	} });
+
+	// The same as replay_clues, but each clue is added as a trial and then committed
+	ret.push_back({ "replay_trials", [dic](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		Field field(entry.problem.height(), entry.problem.width(), dic);
+		for (CellPosition pos : entry.clue_order) {
+			field.BeginTrial();
+			field.AddClue(pos, entry.problem.GetClue(pos));
+			field.CommitTrial();
+		}
+		return Clock::now() - start;
+	} });
+
+	// Only GridLoop: the edges of the solution are decided in a random order
+	ret.push_back({ "decide_edges", [](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		PlainGridLoop grid(entry.problem.height(), entry.problem.width());
+		for (auto &e : entry.solution_edges) grid.DecideEdge(e.first, e.second);
+		return Clock::now() - start;
+	} });
+
+	// The trial-and-error technique on a field with half of the clues
+	ret.push_back({ "assume", [dic](const CorpusEntry &entry) {
+		Field field(entry.problem.height(), entry.problem.width(), dic);
+		for (std::size_t i = 0; i < entry.clue_order.size() / 2; ++i) {
+			field.AddClue(entry.clue_order[i], entry.problem.GetClue(entry.clue_order[i]));
+		}
+		GetGridLoopStats().Reset();
+		Clock::time_point start = Clock::now();
+		Assume(&field);
+		return Clock::now() - start;
+	} });
+
+	ret.push_back({ "assume_incremental", [dic](const CorpusEntry &entry) {
+		Field field(entry.problem.height(), entry.problem.width(), dic);
+		for (std::size_t i = 0; i < entry.clue_order.size() / 2; ++i) {
+			field.AddClue(entry.clue_order[i], entry.problem.GetClue(entry.clue_order[i]));
+		}
+		GetGridLoopStats().Reset();
+		Clock::time_point start = Clock::now();
+		AssumeIncremental(&field);
+		return Clock::now() - start;
+	} });
+
+	// The same as construct, replay_clues and assume, but with GridLoopMethod::prioritized_queue
+	Method prioritized;
+	prioritized.grid_loop_method.prioritized_queue = true;
+
+	ret.push_back({ "construct_prioritized", [dic, prioritized](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		Field field(entry.problem, dic, prioritized);
+		return Clock::now() - start;
+	} });
+
+	ret.push_back({ "replay_clues_prioritized", [dic, prioritized](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		Field field(entry.problem.height(), entry.problem.width(), dic, prioritized);
+		for (CellPosition pos : entry.clue_order) field.AddClue(pos, entry.problem.GetClue(pos));
+		return Clock::now() - start;
+	} });
+
+	ret.push_back({ "assume_prioritized", [dic, prioritized](const CorpusEntry &entry) {
+		Field field(entry.problem.height(), entry.problem.width(), dic, prioritized);
+		for (std::size_t i = 0; i < entry.clue_order.size() / 2; ++i) {
+			field.AddClue(entry.clue_order[i], entry.problem.GetClue(entry.clue_order[i]));
+		}
+		GetGridLoopStats().Reset();
+		Clock::time_point start = Clock::now();
+		Assume(&field);
+		return Clock::now() - start;
+	} });
+
+	ret.push_back({ "copy_construct", [](const CorpusEntry &entry) {
+		Clock::time_point start = Clock::now();
+		Field field(entry.solved);
+		return Clock::now() - start;
+	} });
+
+	ret.push_back({ "copy_assign", [](const CorpusEntry &entry) {
+		Field field(entry.problem.height(), entry.problem.width());
+		GetGridLoopStats().Reset();
+		Clock::time_point start = Clock::now();
+		field = entry.solved;
+		return Clock::now() - start;
+	} });
+
+	return ret;
+}
+
+void PrintResult(const std::string &name, int n_ops, double seconds, const GridLoopStats &stats, bool json)
+{
+	double ns_per_op = seconds * 1e9 / n_ops;
+	double ns_per_decided_edge = stats.decided_edges > 0 ? seconds * 1e9 / stats.decided_edges : 0.0;
+	auto per_op = [n_ops](unsigned long long v) { return static_cast<double>(v) / n_ops; };
+
+	if (json) {
+		std::cout << "{\"case\":\"" << name << "\""
+			<< ",\"ops\":" << n_ops
+			<< ",\"ns_per_op\":" << ns_per_op
+			<< ",\"ns_per_decided_edge\":" << ns_per_decided_edge
+			<< ",\"decided_edges_per_op\":" << per_op(stats.decided_edges)
+			<< ",\"joins_per_op\":" << per_op(stats.joins)
+			<< ",\"vertex_inspections_per_op\":" << per_op(stats.vertex_inspections)
+			<< ",\"inspections_per_op\":" << per_op(stats.inspections)
+			<< ",\"queue_pushes_per_op\":" << per_op(stats.queue_pushes)
+			<< ",\"queue_pops_per_op\":" << per_op(stats.queue_pops)
+			<< "}" << std::endl;
+	} else {
+		std::cout << name << "," << n_ops << "," << ns_per_op << "," << ns_per_decided_edge
+			<< "," << per_op(stats.decided_edges) << "," << per_op(stats.joins)
+			<< "," << per_op(stats.vertex_inspections) << "," << per_op(stats.inspections)
+			<< "," << per_op(stats.queue_pushes) << "," << per_op(stats.queue_pops) << std::endl;
+	}
+}
+}
+
+int main(int argc, char** argv)
+{
+	int n_problems = 3;
+	int n_repeats = 20;
+	unsigned int seed = 0;
+	std::string filter = "";
+	bool json = false;
+	bool show_rules = false;
+	bool use_pair_table = false;
+
+	for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+		std::string opt = argv[arg_idx];
+		if (opt == "--help") {
+			ShowUsage(argc, argv);
+			return 0;
+		} else if (opt == "--json") {
+			json = true;
+		} else if (opt == "--rules") {
+			show_rules = true;
+		} else if (opt == "--pair-table") {
+			use_pair_table = true;
+		} else if (opt == "-n" || opt == "-r" || opt == "-s" || opt == "-f") {
+			if (arg_idx + 1 >= argc) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+			std::istringstream iss(argv[++arg_idx]);
+			if (opt == "-n") iss >> n_problems;
+			else if (opt == "-r") iss >> n_repeats;
+			else if (opt == "-s") iss >> seed;
+			else iss >> filter;
+			if (iss.fail()) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+		} else {
+			std::cerr << "error: unrecognized option '" << opt << "'" << std::endl;
+			return 0;
+		}
+	}
+
+#ifndef PENCILOID_GRID_LOOP_STATS
+	std::cerr << "note: built without PENCILOID_GRID_LOOP_STATS; operation counters are not available" << std::endl;
+#endif
+
+	Dictionary dic;
+	dic.CreateDefault();
+
+	std::cerr << "generating the corpus..." << std::endl;
+	std::vector<CorpusEntry> corpus = MakeCorpus(&dic, n_problems, seed);
+	// The corpus is the same regardless of --pair-table
+	if (use_pair_table) dic.CreatePairTable();
+
+	if (!json) {
+		std::cout << "case,ops,ns_per_op,ns_per_decided_edge,decided_edges_per_op,joins_per_op,vertex_inspections_per_op,inspections_per_op,queue_pushes_per_op,queue_pops_per_op" << std::endl;
+	}
+	for (auto &c : MakeCases(&dic)) {
+		if (c.first.find(filter) == std::string::npos) continue;
+
+		Clock::duration total = Clock::duration::zero();
+		GridLoopStats stats;
+		int n_ops = 0;
+		for (int rep = 0; rep < n_repeats; ++rep) {
+			for (const CorpusEntry &entry : corpus) {
+				GetGridLoopStats().Reset();
+				total += c.second(entry);
+				stats += GetGridLoopStats();
+				++n_ops;
+			}
+		}
+		PrintResult(c.first, n_ops, std::chrono::duration<double>(total).count(), stats, json);
+		if (show_rules) {
+			std::cerr << "rules of " << c.first << ":" << std::endl;
+			stats.PrintRules(std::cerr);
+		}
+	}
+	return 0;
+}
\ No newline at end of file
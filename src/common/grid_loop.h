@@ -10,6 +10,7 @@
 #include "grid_loop_method.h"
 #include "auto_array.h"
 #include "search_queue.h"
+#include "grid_loop_stats.h"
 
 #include<cassert>
 
@@ -60,7 +61,7 @@ public:
 	bool IsInAbnormalCondition() const { return abnormal_; }
 	void SetInconsistent() { 
 		if (!history_.empty() && !inconsistent_) {
-			history_.push_back({ kHistorySetInconsistent, FieldComponent() });
+			history_.push_back({ kHistorySetInconsistent, kEdgeUndecided, 0 });
 		}
 		inconsistent_ = true;
 	}
@@ -107,6 +108,7 @@ public:
 	void Check(LoopPosition pos);
 
 	// Perform Check(pos) for all possible (vertex / cell / edge).
+	// The positions are enqueued in bulk, in the row-major order.
 	void CheckAllVertex();
 	void CheckAllCell();
 	void CheckAllEdge();
@@ -117,6 +119,32 @@ public:
 	// Roll back this field to the last restore point
 	void Rollback();
 
+	// The changes undone by Rollback(RedoLog*), which can be made again by Redo().
+	struct RedoLog;
+
+	// Same as Rollback(), but the undone changes (including the restore point) are appended to <redo>.
+	void Rollback(RedoLog *redo);
+
+	// Make the changes recorded in <redo> again in the reverse order of recording, and consume them.
+	// The history is recorded as if the changes were made in the ordinary way.
+	void Redo(RedoLog *redo);
+
+	// Remove the last restore point without rolling back.
+	// Changes made after it will be undone by the rollback to the previous restore point (if any).
+	void DiscardRestorePoint();
+
+	// Remove the first (outermost) restore point without rolling back.
+	// Changes made before the next restore point can't be undone any more.
+	void DiscardOldestRestorePoint();
+
+	// Call <func>(edge) for each edge whose status or chain was changed after the last restore point.
+	// An edge may be visited more than once.
+	template <class F>
+	void ForEachChangeSinceRestorePoint(F func) const;
+
+	// Returns the statistics of the propagation in the current thread, which are collected only if PENCILOID_GRID_LOOP_STATS is defined.
+	static GridLoopStats GetPropagationStats() { return GetGridLoopStats(); }
+
 	//
 	// Public methods below are intended to be "overridden" by the subclass.
 	//
@@ -133,6 +161,11 @@ public:
 	// Don't call this method directly (instead, use Check(pos) ).
 	void Inspect(LoopPosition pos) {}
 
+	// This method (of the subclass) should return the level of <pos> in [0, SearchQueue::kNumberOfLevels).
+	// If GridLoopMethod::prioritized_queue is set, positions of lower levels are inspected first,
+	// so cheap deductions are saturated before expensive ones run.
+	int GetInspectionLevel(LoopPosition pos) { return 0; }
+
 	// Invoke func() with the internal queue enabled.
 	template <class F>
 	void QueuedRun(F func) {
@@ -146,29 +179,37 @@ public:
 	}
 
 private:
+	// Chain metadata of an edge. Only edges have this, so it is stored in an edges-only table (see chain_).
+	// Edges on an end of a chain should have correct end_vertices, another_end_edge and chain_size.
+	// For other edges, following another_end_edge should lead to an end of the chain.
+	// Additionally, all edge of the same chain of an edge should be able to be computed by following list_next_edge.
+	// All ids stored here are ids of the (2 * height + 1) x (2 * width + 1) lattice.
 	struct FieldComponent
 	{
-		union {
-			// Edges on an end of a chain should have correct end_vertices, another_end_edge and chain_size.
-			// For other edges, following another_end_edge should lead to an end of the chain.
-			// Additionally, all edge of the same chain of an edge should be able to be computed by following list_next_edge.
-			// Each edge should have correct edge_status.
-			struct { // as an edge
-				EdgeState edge_status;
-				unsigned int end_vertices[2];
-				unsigned int another_end_edge;
-				unsigned int list_next_edge;
-				EdgeCount chain_size;
-			};
-			struct { // as a vertex
-
-			};
-		};
+		unsigned int end_vertices[2];
+		unsigned int another_end_edge;
+		unsigned int list_next_edge;
+		EdgeCount chain_size;
+	};
+	// history_ is an undo log of typed entries. Only kHistoryChain entries carry a snapshot of FieldComponent,
+	// which is kept in chain_history_ (the last unconsumed element belongs to the last kHistoryChain entry).
+	enum HistoryKind : unsigned char
+	{
+		kHistoryRestorePoint,
+		kHistorySetInconsistent,
+		kHistorySetSolved,
+		kHistoryEdgeStatus, // the status of edge <id> was <edge_status>
+		kHistoryChain       // the chain metadata of edge <id> was changed
+	};
+	struct HistoryEntry
+	{
+		HistoryKind kind;
+		unsigned char edge_status;
+		unsigned int id;
 	};
 
-	const int kHistoryRestorePoint = -1;
-	const int kHistorySetInconsistent = -2;
-	const int kHistorySetSolved = -3;
+	// The status of each edge is packed into 2 bits, 16 edges per word.
+	static const int kEdgesPerWord = 16;
 
 	bool IsVertex(LoopPosition pos) const { return pos.y % 2 == 0 && pos.x % 2 == 0; }
 	bool IsEdge(LoopPosition pos) const { return static_cast<int>(pos.y % 2) != static_cast<int>(pos.x % 2); }
@@ -178,11 +219,34 @@ private:
 	LoopPosition AsPosition(unsigned int id) const { return LoopPosition(Y(id / (2 * int(width_) + 1)), X(id % (2 * int(width_) + 1))); }
 
 	bool IsEndOfAChain(LoopPosition edge) const { return IsEndOfAChain(Id(edge)); }
-	bool IsEndOfAChain(unsigned int edge_id) const { return field_[field_[edge_id].another_end_edge].another_end_edge == edge_id; }
+	bool IsEndOfAChain(unsigned int edge_id) const { return Chain(Chain(edge_id).another_end_edge).another_end_edge == edge_id; }
 	bool IsEndOfAChainVertex(unsigned int edge_id, unsigned int vertex_id) const;
 	unsigned int GetAnotherEndAsId(LoopPosition point, Direction dir) const;
 
+	// Since (2 * width + 1) is odd, lattice ids of edges are exactly the odd ones.
+	// Hence (id >> 1) enumerates edges in row-major order without gaps.
+	static unsigned int EdgeIndex(unsigned int edge_id) { return edge_id >> 1; }
+	static unsigned int NumberOfEdges(Y height, X width) { return (static_cast<int>(height) * 2 + 1) * (static_cast<int>(width) * 2 + 1) / 2; }
+	FieldComponent &Chain(unsigned int edge_id) { return chain_[EdgeIndex(edge_id)]; }
+	const FieldComponent &Chain(unsigned int edge_id) const { return chain_[EdgeIndex(edge_id)]; }
+	EdgeState GetEdgeById(unsigned int edge_id) const {
+		unsigned int idx = EdgeIndex(edge_id);
+		return static_cast<EdgeState>((edge_state_[idx / kEdgesPerWord] >> (2 * (idx % kEdgesPerWord))) & 3);
+	}
+	void SetEdgeById(unsigned int edge_id, EdgeState status) {
+		unsigned int idx = EdgeIndex(edge_id);
+		unsigned int &word = edge_state_[idx / kEdgesPerWord];
+		word = (word & ~(3U << (2 * (idx % kEdgesPerWord)))) | (static_cast<unsigned int>(status) << (2 * (idx % kEdgesPerWord)));
+	}
+
 	void Check(unsigned int id) { Check(AsPosition(id)); }
+	void PushToQueue(LoopPosition pos) {
+		if (method_.prioritized_queue) PushToQueueWithLevel(pos);
+		else queue_.Push(Id(pos));
+	}
+	void PushToQueueWithLevel(LoopPosition pos);
+	// Check first, first + step, ... (less than last) in bulk
+	void CheckRange(unsigned int first, unsigned int last, int step);
 	void DecideChain(unsigned int id, EdgeState status);
 	void CheckNeighborhoodOfChain(unsigned int id);
 	void HasFullySolved();
@@ -192,9 +256,11 @@ private:
 
 	void QueueProcessAll();
 
-	AutoArray<FieldComponent> field_;
+	AutoArray<unsigned int> edge_state_;
+	AutoArray<FieldComponent> chain_;
 	SearchQueue queue_;
-	std::vector<std::pair<int, FieldComponent> > history_;
+	std::vector<HistoryEntry> history_;
+	std::vector<FieldComponent> chain_history_;
 
 	Y height_;
 	X width_;
@@ -203,11 +269,20 @@ private:
 
 	GridLoopMethod method_;
 };
+template <class T>
+struct GridLoop<T>::RedoLog
+{
+	// The same as the entries of history_, except that kHistoryEdgeStatus entries hold the new status
+	std::vector<HistoryEntry> history;
+	std::vector<FieldComponent> chains;
+};
 template<class T>
 GridLoop<T>::GridLoop()
-	: field_(),
+	: edge_state_(),
+	  chain_(),
 	  queue_(),
 	  history_(),
+	  chain_history_(),
 	  height_(0),
 	  width_(0),
 	  decided_edges_(0),
@@ -220,9 +295,11 @@ GridLoop<T>::GridLoop()
 }
 template<class T>
 GridLoop<T>::GridLoop(Y height, X width)
-	: field_((static_cast<int>(height) * 2 + 1) * (static_cast<int>(width) * 2 + 1)),
+	: edge_state_((NumberOfEdges(height, width) + kEdgesPerWord - 1) / kEdgesPerWord),
+	  chain_(NumberOfEdges(height, width)),
 	  queue_((static_cast<int>(height) * 2 + 1) * (static_cast<int>(width) * 2 + 1)),
 	  history_(),
+	  chain_history_(),
 	  height_(height),
 	  width_(width),
 	  decided_edges_(0),
@@ -232,21 +309,22 @@ GridLoop<T>::GridLoop(Y height, X width)
 	  abnormal_(false),
 	  method_()
 {
+	std::fill(edge_state_.begin(), edge_state_.end(), 0U); // every edge is kEdgeUndecided (= 0)
 	for (Y y(0); y <= 2 * height_; ++y) {
 		for (X x(0); x <= 2 * width_; ++x) {
 			unsigned int id = Id(y, x);
 			if (int(y % 2) != int(x % 2)) { // Edge
-				field_[id].edge_status = kEdgeUndecided;
+				FieldComponent &edge = Chain(id);
 				if (y % 2 == 0) {
-					field_[id].end_vertices[0] = Id(y, x - 1);
-					field_[id].end_vertices[1] = Id(y, x + 1);
+					edge.end_vertices[0] = Id(y, x - 1);
+					edge.end_vertices[1] = Id(y, x + 1);
 				} else {
-					field_[id].end_vertices[0] = Id(y - 1, x);
-					field_[id].end_vertices[1] = Id(y + 1, x);
+					edge.end_vertices[0] = Id(y - 1, x);
+					edge.end_vertices[1] = Id(y + 1, x);
 				}
-				field_[id].another_end_edge = id;
-				field_[id].list_next_edge = id;
-				field_[id].chain_size = 1;
+				edge.another_end_edge = id;
+				edge.list_next_edge = id;
+				edge.chain_size = 1;
 			}
 		}
 	}
@@ -261,9 +339,11 @@ GridLoop<T>::GridLoop(Y height, X width)
 }
 template<class T>
 GridLoop<T>::GridLoop(const GridLoop<T> &other)
-	: field_(other.field_),
+	: edge_state_(other.edge_state_),
+	  chain_(other.chain_),
 	  queue_((static_cast<int>(other.height()) * 2 + 1) * (static_cast<int>(other.width()) * 2 + 1)),
 	  history_(other.history_),
+	  chain_history_(other.chain_history_),
 	  height_(other.height_),
 	  width_(other.width_),
 	  decided_edges_(other.decided_edges_),
@@ -276,9 +356,11 @@ GridLoop<T>::GridLoop(const GridLoop<T> &other)
 }
 template<class T>
 GridLoop<T>::GridLoop(GridLoop<T> &&other)
-	: field_(std::move(other.field_)),
+	: edge_state_(std::move(other.edge_state_)),
+	  chain_(std::move(other.chain_)),
 	  queue_(std::move(other.queue_)),
 	  history_(std::move(other.history_)),
+	  chain_history_(std::move(other.chain_history_)),
 	  height_(other.height_),
 	  width_(other.width_),
 	  decided_edges_(other.decided_edges_),
@@ -301,9 +383,11 @@ GridLoop<T> &GridLoop<T>::operator=(const GridLoop<T> &other)
 	abnormal_ = other.abnormal_;
 	method_ = other.method_;
 
-	field_ = other.field_;
+	edge_state_ = other.edge_state_;
+	chain_ = other.chain_;
 	queue_ = other.queue_;
 	history_ = other.history_;
+	chain_history_ = other.chain_history_;
 
 	return *this;
 }
@@ -314,14 +398,16 @@ GridLoop<T> &GridLoop<T>::operator=(GridLoop<T> &&other)
 	width_ = other.width_;
 	decided_edges_ = other.decided_edges_;
 	decided_lines_ = other.decided_lines_;
-	inconsistent_ = other.inconsitent_;
+	inconsistent_ = other.inconsistent_;
 	fully_solved_ = other.fully_solved_;
 	abnormal_ = other.abnormal_;
 	method_ = other.method_;
 
-	field_ = std::move(other.field_);
+	edge_state_ = std::move(other.edge_state_);
+	chain_ = std::move(other.chain_);
 	queue_ = std::move(other.queue_);
 	history_ = std::move(other.history_);
+	chain_history_ = std::move(other.chain_history_);
 
 	return *this;
 }
@@ -332,7 +418,7 @@ GridLoop<T>::~GridLoop()
 template<class T>
 typename GridLoop<T>::EdgeState GridLoop<T>::GetEdge(LoopPosition edge) const
 {
-	return field_[Id(edge)].edge_status;
+	return GetEdgeById(Id(edge));
 }
 template<class T>
 typename GridLoop<T>::EdgeState GridLoop<T>::GetEdgeSafe(LoopPosition edge) const
@@ -351,8 +437,8 @@ void GridLoop<T>::DecideEdge(LoopPosition edge, EdgeState status)
 	}
 
 	unsigned int id = Id(edge);
-	if (field_[id].edge_status == status) return;
-	if (field_[id].edge_status != kEdgeUndecided) {
+	if (GetEdgeById(id) == status) return;
+	if (GetEdgeById(id) != kEdgeUndecided) {
 		SetInconsistent();
 		return;
 	}
@@ -373,46 +459,46 @@ void GridLoop<T>::DecideEdge(LoopPosition edge, EdgeState status)
 template<class T>
 LoopPosition GridLoop<T>::GetAnotherEnd(LoopPosition point, Direction dir) const
 {
-	unsigned int edge_id = Id(point + dir);
-	return AsPosition(field_[edge_id].end_vertices[0] + field_[edge_id].end_vertices[1] - Id(point));
+	const FieldComponent &edge = Chain(Id(point + dir));
+	return AsPosition(edge.end_vertices[0] + edge.end_vertices[1] - Id(point));
 }
 template<class T>
 typename GridLoop<T>::EdgeCount GridLoop<T>::GetChainLength(LoopPosition point, Direction dir) const
 {
-	return field_[Id(point + dir)].chain_size;
+	return Chain(Id(point + dir)).chain_size;
 }
 template<class T>
 std::pair<LoopPosition, LoopPosition> GridLoop<T>::GetEndsOfChain(LoopPosition edge) const
 {
 	unsigned int edge_id = Id(edge);
 	while (!IsEndOfAChain(edge_id)) {
-		edge_id = field_[edge_id].another_end_edge;
+		edge_id = Chain(edge_id).another_end_edge;
 	}
-	return{ AsPosition(field_[edge_id].end_vertices[0]), AsPosition(field_[edge_id].end_vertices[1]) };
+	return{ AsPosition(Chain(edge_id).end_vertices[0]), AsPosition(Chain(edge_id).end_vertices[1]) };
 }
 template <class T>
 unsigned int GridLoop<T>::GetChainIdentifier(LoopPosition edge) const
 {
 	unsigned int edge_id = Id(edge);
 	while (!IsEndOfAChain(edge_id)) {
-		edge_id = field_[edge_id].another_end_edge;
+		edge_id = Chain(edge_id).another_end_edge;
 	}
-	return std::min(edge_id, field_[edge_id].another_end_edge);
+	return std::min(edge_id, Chain(edge_id).another_end_edge);
 }
 template <class T>
 bool GridLoop<T>::IsRepresentativeOfChain(LoopPosition edge) const
 {
 	unsigned int edge_id = Id(edge);
-	return IsEndOfAChain(edge_id) && edge_id <= field_[edge_id].another_end_edge;
+	return IsEndOfAChain(edge_id) && edge_id <= Chain(edge_id).another_end_edge;
 }
 template<class T>
 bool GridLoop<T>::IsEndOfAChainVertex(unsigned int edge_id, unsigned int vertex_id) const {
-	return field_[edge_id].end_vertices[0] == vertex_id || field_[edge_id].end_vertices[1] == vertex_id;
+	return Chain(edge_id).end_vertices[0] == vertex_id || Chain(edge_id).end_vertices[1] == vertex_id;
 }
 template<class T>
 unsigned int GridLoop<T>::GetAnotherEndAsId(LoopPosition point, Direction dir) const {
-	unsigned int edge_id = Id(point + dir);
-	return field_[edge_id].end_vertices[0] + field_[edge_id].end_vertices[1] - Id(point);
+	const FieldComponent &edge = Chain(Id(point + dir));
+	return edge.end_vertices[0] + edge.end_vertices[1] - Id(point);
 }
 template <class T>
 void GridLoop<T>::Check(LoopPosition pos)
@@ -420,11 +506,11 @@ void GridLoop<T>::Check(LoopPosition pos)
 	if (!IsPositionOnField(pos)) return;
 
 	if (queue_.IsActive()) {
-		queue_.Push(Id(pos));
+		PushToQueue(pos);
 	} else {
 		queue_.Activate();
 
-		queue_.Push(Id(pos));
+		PushToQueue(pos);
 		QueueProcessAll();
 
 		queue_.Deactivate();
@@ -434,10 +520,8 @@ template <class T>
 void GridLoop<T>::CheckAllVertex()
 {
 	QueuedRun([&]() {
-		for (Y y(0); y <= 2 * height_; ++y) {
-			for (X x(0); x <= 2 * width_; ++x) {
-				Check(LoopPosition(y, x));
-			}
+		for (Y y(0); y <= 2 * height_; y += 2) {
+			CheckRange(Id(y, X(0)), Id(y, 2 * width_) + 1, 2);
 		}
 	});
 }
@@ -446,62 +530,177 @@ template <class T>
 void GridLoop<T>::CheckAllCell()
 {
 	QueuedRun([&]() {
-		for (Y y(1); y < 2 * height_; ++y) {
-			for (X x(1); x < 2 * width_; ++x) {
-				Check(LoopPosition(y, x));
-			}
+		for (Y y(1); y < 2 * height_; y += 2) {
+			CheckRange(Id(y, X(1)), Id(y, 2 * width_), 2);
 		}
 	});
 }
 template <class T>
 void GridLoop<T>::CheckAllEdge()
 {
+	// Lattice ids of edges are exactly the odd ones (see EdgeIndex)
 	QueuedRun([&]() {
-		for (Y y(0); y <= 2 * height_; ++y) {
-			for (X x(0); x <= 2 * width_; ++x) {
-				if (static_cast<int>(y % 2) != static_cast<int>(x % 2)) Check(LoopPosition(y, x));
-			}
-		}
+		CheckRange(1, Id(2 * height_, 2 * width_), 2);
 	});
 }
 template <class T>
+void GridLoop<T>::PushToQueueWithLevel(LoopPosition pos)
+{
+	queue_.Push(Id(pos), static_cast<T*>(this)->GetInspectionLevel(pos));
+}
+template <class T>
+void GridLoop<T>::CheckRange(unsigned int first, unsigned int last, int step)
+{
+	if (method_.prioritized_queue) {
+		// Each position may have a different level
+		for (unsigned int id = first; id < last; id += step) PushToQueue(AsPosition(id));
+	} else {
+		queue_.PushRange(first, last, step);
+	}
+}
+template <class T>
 void GridLoop<T>::AddRestorePoint()
 {
-	history_.push_back({ -1, FieldComponent() });
+	history_.push_back({ kHistoryRestorePoint, kEdgeUndecided, 0 });
 }
 template <class T>
 void GridLoop<T>::Rollback()
+{
+	Rollback(nullptr);
+}
+template <class T>
+void GridLoop<T>::Rollback(RedoLog *redo)
 {
 	while (!history_.empty()) {
-		auto last = history_.back();
+		HistoryEntry last = history_.back();
 		history_.pop_back();
 
-		if (last.first == kHistoryRestorePoint) break;
-		if (last.first == kHistorySetInconsistent) {
+		if (redo != nullptr) {
+			HistoryEntry current = last;
+			if (last.kind == kHistoryEdgeStatus) current.edge_status = static_cast<unsigned char>(GetEdgeById(last.id));
+			if (last.kind == kHistoryChain) redo->chains.push_back(Chain(last.id));
+			redo->history.push_back(current);
+		}
+
+		if (last.kind == kHistoryRestorePoint) break;
+		switch (last.kind) {
+		case kHistorySetInconsistent:
 			inconsistent_ = false;
-		} else if (last.first == kHistorySetSolved) {
+			break;
+		case kHistorySetSolved:
 			fully_solved_ = false;
-		} else {
-			if (field_[last.first].edge_status != kEdgeUndecided && last.second.edge_status == kEdgeUndecided) {
+			break;
+		case kHistoryEdgeStatus: {
+			EdgeState current_status = GetEdgeById(last.id);
+			EdgeState previous_status = static_cast<EdgeState>(last.edge_status);
+			if (current_status != kEdgeUndecided && previous_status == kEdgeUndecided) {
 				--decided_edges_;
-				if (field_[last.first].edge_status == kEdgeLine) --decided_lines_;
+				if (current_status == kEdgeLine) --decided_lines_;
+			}
+			SetEdgeById(last.id, previous_status);
+			break;
+		}
+		case kHistoryChain:
+			Chain(last.id) = chain_history_.back();
+			chain_history_.pop_back();
+			break;
+		default:
+			break;
+		}
+	}
+}
+template <class T>
+void GridLoop<T>::Redo(RedoLog *redo)
+{
+	while (!redo->history.empty()) {
+		HistoryEntry next = redo->history.back();
+		redo->history.pop_back();
+
+		switch (next.kind) {
+		case kHistorySetInconsistent:
+			inconsistent_ = true;
+			break;
+		case kHistorySetSolved:
+			fully_solved_ = true;
+			break;
+		case kHistoryEdgeStatus: {
+			EdgeState previous_status = GetEdgeById(next.id);
+			EdgeState new_status = static_cast<EdgeState>(next.edge_status);
+			if (previous_status == kEdgeUndecided && new_status != kEdgeUndecided) {
+				++decided_edges_;
+				if (new_status == kEdgeLine) ++decided_lines_;
+			}
+			SetEdgeById(next.id, new_status);
+			next.edge_status = static_cast<unsigned char>(previous_status);
+			break;
+		}
+		case kHistoryChain:
+			chain_history_.push_back(Chain(next.id));
+			Chain(next.id) = redo->chains.back();
+			redo->chains.pop_back();
+			break;
+		default:
+			break;
+		}
+		history_.push_back(next);
+	}
+}
+template <class T>
+void GridLoop<T>::DiscardRestorePoint()
+{
+	for (std::size_t i = history_.size(); i-- > 0;) {
+		if (history_[i].kind == kHistoryRestorePoint) {
+			// The first entry of the history is always the outermost restore point.
+			// If it is removed, no more history has to be recorded.
+			if (i == 0) {
+				history_.clear();
+				chain_history_.clear();
+			} else {
+				history_.erase(history_.begin() + i);
 			}
-			field_[last.first] = last.second;
+			return;
 		}
 	}
 }
 template <class T>
+void GridLoop<T>::DiscardOldestRestorePoint()
+{
+	// The chain snapshots of the discarded entries are at the beginning of chain_history_
+	std::size_t n_chains = 0;
+	for (std::size_t i = 1; i < history_.size(); ++i) {
+		if (history_[i].kind == kHistoryRestorePoint) {
+			history_.erase(history_.begin(), history_.begin() + i);
+			chain_history_.erase(chain_history_.begin(), chain_history_.begin() + n_chains);
+			return;
+		}
+		if (history_[i].kind == kHistoryChain) ++n_chains;
+	}
+	history_.clear();
+	chain_history_.clear();
+}
+template <class T>
+template <class F>
+void GridLoop<T>::ForEachChangeSinceRestorePoint(F func) const
+{
+	for (std::size_t i = history_.size(); i-- > 0;) {
+		const HistoryEntry &entry = history_[i];
+		if (entry.kind == kHistoryRestorePoint) break;
+		if (entry.kind == kHistoryEdgeStatus || entry.kind == kHistoryChain) func(AsPosition(entry.id));
+	}
+}
+template <class T>
 void GridLoop<T>::DecideChain(unsigned int id, EdgeState status)
 {
 	unsigned int id_start = id;
 	do {
 		if (!history_.empty()) {
-			history_.push_back({ id, field_[id] });
+			history_.push_back({ kHistoryEdgeStatus, static_cast<unsigned char>(GetEdgeById(id)), id });
 		}
-		field_[id].edge_status = status;
+		SetEdgeById(id, status);
+		PENCILOID_GRID_LOOP_COUNT_DECIDED_EDGE();
 		++decided_edges_;
 		if (status == kEdgeLine) ++decided_lines_;
-		id = field_[id].list_next_edge;
+		id = Chain(id).list_next_edge;
 	} while (id != id_start);
 }
 template <class T>
@@ -510,7 +709,7 @@ void GridLoop<T>::CheckNeighborhoodOfChain(unsigned int id)
 	unsigned int id_start = id;
 	do {
 		static_cast<T*>(this)->CheckNeighborhood(AsPosition(id));
-		id = field_[id].list_next_edge;
+		id = Chain(id).list_next_edge;
 	} while (id != id_start);
 }
 template <class T>
@@ -527,49 +726,52 @@ void GridLoop<T>::HasFullySolved()
 template <class T>
 void GridLoop<T>::Join(LoopPosition vertex, Direction dir1, Direction dir2)
 {
+	PENCILOID_GRID_LOOP_RULE(kRuleJoin);
+
 	unsigned int edge1_id = Id(vertex + dir1);
 	unsigned int edge2_id = Id(vertex + dir2);
 
-	if (field_[edge1_id].end_vertices[0] != Id(vertex) && field_[edge1_id].end_vertices[1] != Id(vertex)) return;
-	if (field_[edge2_id].end_vertices[0] != Id(vertex) && field_[edge2_id].end_vertices[1] != Id(vertex)) return;
+	if (Chain(edge1_id).end_vertices[0] != Id(vertex) && Chain(edge1_id).end_vertices[1] != Id(vertex)) return;
+	if (Chain(edge2_id).end_vertices[0] != Id(vertex) && Chain(edge2_id).end_vertices[1] != Id(vertex)) return;
 	if (!IsEndOfAChain(edge1_id) || !IsEndOfAChain(edge2_id)) return;
-	if (field_[edge1_id].another_end_edge == edge2_id) return; // avoid joining the same chain again
+	if (Chain(edge1_id).another_end_edge == edge2_id) return; // avoid joining the same chain again
 
 	unsigned int end1_vertex = GetAnotherEndAsId(vertex, dir1);
 	unsigned int end2_vertex = GetAnotherEndAsId(vertex, dir2);
-	unsigned int end1_edge = field_[edge1_id].another_end_edge;
-	unsigned int end2_edge = field_[edge2_id].another_end_edge;
+	unsigned int end1_edge = Chain(edge1_id).another_end_edge;
+	unsigned int end2_edge = Chain(edge2_id).another_end_edge;
 
 	// change the status of edges if necessary
-	if (field_[edge1_id].edge_status == kEdgeUndecided && field_[edge2_id].edge_status != kEdgeUndecided) {
-		DecideChain(edge1_id, field_[edge2_id].edge_status);
+	if (GetEdgeById(edge1_id) == kEdgeUndecided && GetEdgeById(edge2_id) != kEdgeUndecided) {
+		DecideChain(edge1_id, GetEdgeById(edge2_id));
 		CheckNeighborhoodOfChain(edge1_id);
 		Join(vertex, dir1, dir2); // assure that two edges are still disjoint (or end this function call)
 		return;
 	}
-	if (field_[edge2_id].edge_status == kEdgeUndecided && field_[edge1_id].edge_status != kEdgeUndecided) {
-		DecideChain(edge2_id, field_[edge1_id].edge_status);
+	if (GetEdgeById(edge2_id) == kEdgeUndecided && GetEdgeById(edge1_id) != kEdgeUndecided) {
+		DecideChain(edge2_id, GetEdgeById(edge1_id));
 		CheckNeighborhoodOfChain(edge2_id);
 		Join(vertex, dir1, dir2);
 		return;
 	}
 
 	if (end1_vertex == end2_vertex) {
-		if (field_[edge1_id].edge_status == kEdgeUndecided) {
+		if (GetEdgeById(edge1_id) == kEdgeUndecided) {
 			if (decided_lines_ != 0 && method_.eliminate_closed_chain) {
+				PENCILOID_GRID_LOOP_RULE(kRuleEliminateClosedChain);
 				DecideChain(edge1_id, kEdgeBlank);
 				DecideChain(edge2_id, kEdgeBlank);
 				CheckNeighborhoodOfChain(edge1_id);
 				CheckNeighborhoodOfChain(edge2_id);
 				return;
 			}
-		} else if (field_[edge1_id].edge_status == kEdgeLine) {
-			if (decided_lines_ != field_[edge1_id].chain_size + field_[edge2_id].chain_size) {
+		} else if (GetEdgeById(edge1_id) == kEdgeLine) {
+			if (decided_lines_ != Chain(edge1_id).chain_size + Chain(edge2_id).chain_size) {
 				SetInconsistent();
 			} else {
 				fully_solved_ = true;
 				if (!history_.empty()) {
-					history_.push_back({ kHistorySetSolved, FieldComponent() });
+					history_.push_back({ kHistorySetSolved, kEdgeUndecided, 0 });
 				}
 				HasFullySolved();
 			}
@@ -577,26 +779,30 @@ void GridLoop<T>::Join(LoopPosition vertex, Direction dir1, Direction dir2)
 	}
 
 	if (!history_.empty()) {
-		history_.push_back({ end1_edge, field_[end1_edge] });
-		history_.push_back({ end2_edge, field_[end2_edge] });
+		history_.push_back({ kHistoryChain, kEdgeUndecided, end1_edge });
+		chain_history_.push_back(Chain(end1_edge));
+		history_.push_back({ kHistoryChain, kEdgeUndecided, end2_edge });
+		chain_history_.push_back(Chain(end2_edge));
 	}
 
+	PENCILOID_GRID_LOOP_COUNT(joins);
+
 	// concatinate 2 lists
-	std::swap(field_[end1_edge].list_next_edge, field_[end2_edge].list_next_edge);
+	std::swap(Chain(end1_edge).list_next_edge, Chain(end2_edge).list_next_edge);
 	
 	// update chain_size
-	field_[end1_edge].chain_size = field_[end2_edge].chain_size =
-		field_[edge1_id].chain_size + field_[edge2_id].chain_size;
+	Chain(end1_edge).chain_size = Chain(end2_edge).chain_size =
+		Chain(edge1_id).chain_size + Chain(edge2_id).chain_size;
 
 	// update end_vertices
-	field_[end1_edge].end_vertices[0] = end1_vertex;
-	field_[end1_edge].end_vertices[1] = end2_vertex;
-	field_[end2_edge].end_vertices[0] = end1_vertex;
-	field_[end2_edge].end_vertices[1] = end2_vertex;
+	Chain(end1_edge).end_vertices[0] = end1_vertex;
+	Chain(end1_edge).end_vertices[1] = end2_vertex;
+	Chain(end2_edge).end_vertices[0] = end1_vertex;
+	Chain(end2_edge).end_vertices[1] = end2_vertex;
 
 	// update another_end_edge
-	field_[end1_edge].another_end_edge = end2_edge;
-	field_[end2_edge].another_end_edge = end1_edge;
+	Chain(end1_edge).another_end_edge = end2_edge;
+	Chain(end2_edge).another_end_edge = end1_edge;
 
 	Check(end1_vertex);
 	Check(end2_vertex);
@@ -611,6 +817,9 @@ void GridLoop<T>::InspectVertex(LoopPosition vertex)
 		Direction(Y(0), X(-1))
 	};
 
+	PENCILOID_GRID_LOOP_COUNT(vertex_inspections);
+	PENCILOID_GRID_LOOP_RULE(kRuleInspectVertex);
+
 	MiniVector<int, 4> line_dir, undecided_dir;
 	for (int i = 0; i < 4; ++i) {
 		EdgeState status = GetEdgeSafe(vertex + dirs[i]);
@@ -627,6 +836,7 @@ void GridLoop<T>::InspectVertex(LoopPosition vertex)
 		int line_1 = -1, line_2 = -1;
 
 		if (method_.avoid_three_lines) {
+			PENCILOID_GRID_LOOP_RULE(kRuleAvoidThreeLines);
 			for (int d : undecided_dir) {
 				DecideEdge(vertex + dirs[d], kEdgeBlank);
 			}
@@ -649,6 +859,7 @@ void GridLoop<T>::InspectVertex(LoopPosition vertex)
 					if (cand_dir == -1) cand_dir = i;
 					else cand_dir = -2;
 				} else {
+					PENCILOID_GRID_LOOP_RULE(kRuleAvoidLineCycle);
 					DecideEdge(vertex + dirs[i], kEdgeBlank);
 					return;
 				}
@@ -663,6 +874,7 @@ void GridLoop<T>::InspectVertex(LoopPosition vertex)
 
 		if (undecided_dir.size() == 2 && method_.hourglass_rule1) {
 			// Hourglass rule
+			PENCILOID_GRID_LOOP_RULE(kRuleHourglassRule1);
 			LoopPosition line_end = GetAnotherEnd(vertex, dirs[line_dir[0]]);
 			LoopPosition undecided_end[] = {
 				GetAnotherEnd(vertex, dirs[undecided_dir[0]]),
@@ -711,6 +923,7 @@ void GridLoop<T>::QueueProcessAll()
 		int id = queue_.Pop();
 		if (IsInconsistent()) continue;
 		LoopPosition pos = AsPosition(id);
+		PENCILOID_GRID_LOOP_COUNT(inspections);
 		static_cast<T*>(this)->Inspect(pos);
 		if (IsVertex(pos)) InspectVertex(pos);
 	}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <vector>
+
 #include "grid_loop.h"
 #include "union_find.h"
+#include "thread_pool.h"
 
 namespace penciloid
 {
@@ -130,10 +133,12 @@ void Assume(T *grid)
 					return;
 				}
 				if (field_line.IsInconsistent()) {
+					field_blank.DiscardRestorePoint();
 					*grid = field_blank;
 					field_line = field_blank;
 					updated = true;
 				} else if (field_blank.IsInconsistent()) {
+					field_line.DiscardRestorePoint();
 					*grid = field_line;
 					field_blank = field_line;
 					updated = true;
@@ -146,4 +151,168 @@ void Assume(T *grid)
 		if (!updated) break;
 	}
 }
+// The same as Assume(grid), but after the first scan only the edges whose trial may have a different result are tried again.
+// For each edge, the edges changed in its last trials are recorded, and the edge is tried again only if the field is updated near them.
+// This misses the deductions which depend on distant updates (e.g. through long chains), so the search ends with a scan of all the edges
+// as Assume(grid) does, and goes on until such a scan decides nothing.
+template <class T>
+void AssumeIncremental(T *grid)
+{
+	Y height = grid->GridLoop<T>::height();
+	X width = grid->GridLoop<T>::width();
+	int n_edges = (static_cast<int>(height) * 2 + 1) * (static_cast<int>(width) * 2 + 1) / 2;
+
+	// Edges are numbered in row-major order, which is also the order of Assume(grid)
+	auto edge_index = [width](LoopPosition pos) {
+		return (static_cast<int>(pos.y) * (2 * static_cast<int>(width) + 1) + static_cast<int>(pos.x)) >> 1;
+	};
+	auto edge_position = [width](int idx) {
+		int id = idx * 2 + 1;
+		return LoopPosition(Y(id / (2 * static_cast<int>(width) + 1)), X(id % (2 * static_cast<int>(width) + 1)));
+	};
+
+	// The edge itself and the edges sharing a vertex or a cell with it
+	static const Direction neighbors[] = {
+		Direction(Y(0), X(0)),
+		Direction(Y(-2), X(0)), Direction(Y(2), X(0)), Direction(Y(0), X(-2)), Direction(Y(0), X(2)),
+		Direction(Y(-1), X(-1)), Direction(Y(-1), X(1)), Direction(Y(1), X(-1)), Direction(Y(1), X(1))
+	};
+
+	std::vector<bool> dirty(n_edges, true);
+	std::vector<std::vector<int> > watchers(n_edges); // watchers[e]: the edges whose last trials changed e
+	std::vector<int> trace;
+
+	T field_line = *grid, field_blank = *grid;
+	bool full_scan = true;
+	for (;;) {
+		bool updated = false;
+		for (int i = 0; i < n_edges; ++i) {
+			if (!dirty[i]) continue;
+			dirty[i] = false;
+			LoopPosition edge = edge_position(i);
+			if (grid->GetEdge(edge) != T::kEdgeUndecided) continue;
+
+			field_line.AddRestorePoint();
+			field_blank.AddRestorePoint();
+			field_line.DecideEdge(edge, T::kEdgeLine);
+			field_blank.DecideEdge(edge, T::kEdgeBlank);
+			if (field_line.IsInconsistent() && field_blank.IsInconsistent()) {
+				grid->SetInconsistent();
+				return;
+			}
+			if (field_line.IsInconsistent() || field_blank.IsInconsistent()) {
+				T &field_consistent = field_line.IsInconsistent() ? field_blank : field_line;
+				trace.clear();
+				field_consistent.ForEachChangeSinceRestorePoint([&](LoopPosition pos) { trace.push_back(edge_index(pos)); });
+				field_consistent.DiscardRestorePoint();
+				*grid = field_consistent;
+				if (field_line.IsInconsistent()) field_line = field_blank;
+				else field_blank = field_line;
+
+				for (int e : trace) {
+					LoopPosition changed = edge_position(e);
+					for (Direction d : neighbors) {
+						LoopPosition pos = changed + d;
+						if (!(0 <= pos.y && pos.y <= 2 * height && 0 <= pos.x && pos.x <= 2 * width)) continue;
+						std::vector<int> &w = watchers[edge_index(pos)];
+						for (int t : w) dirty[t] = true;
+						w.clear();
+					}
+				}
+				updated = true;
+			} else {
+				auto watch = [&](LoopPosition pos) {
+					std::vector<int> &w = watchers[edge_index(pos)];
+					if (w.empty() || w.back() != i) w.push_back(i);
+				};
+				field_line.ForEachChangeSinceRestorePoint(watch);
+				field_blank.ForEachChangeSinceRestorePoint(watch);
+				field_line.Rollback();
+				field_blank.Rollback();
+			}
+		}
+		if (updated) {
+			full_scan = false;
+		} else {
+			if (full_scan) break;
+			dirty.assign(n_edges, true);
+			full_scan = true;
+		}
+	}
+}
+// The same as Assume(grid), but the edges are tried by the workers of <pool>, each with its own copies of the field.
+// A batch of edges is tried against the current field, and the first edge (in the order of Assume(grid)) which turns out
+// to be decided is applied before the next batch, so that the result is identical to Assume(grid).
+template <class T>
+void Assume(T *grid, ThreadPool *pool)
+{
+	if (pool == nullptr || pool->size() == 1) {
+		Assume(grid);
+		return;
+	}
+
+	Y height = grid->GridLoop<T>::height();
+	X width = grid->GridLoop<T>::width();
+	int n_workers = pool->size();
+	const int batch_size = n_workers * 4;
+
+	std::vector<LoopPosition> edges;
+	for (Y y(0); y <= height * 2; ++y) {
+		for (X x(0); x <= width * 2; ++x) {
+			if (static_cast<int>(y % 2) != static_cast<int>(x % 2)) edges.push_back(LoopPosition(y, x));
+		}
+	}
+
+	// The copies of each worker are refreshed only when <grid> was updated since the last refresh
+	std::vector<T> fields_line(n_workers, *grid), fields_blank(n_workers, *grid);
+	std::vector<int> worker_version(n_workers, 0);
+	int version = 0;
+
+	std::vector<int> batch;  // indices of <edges>
+	std::vector<int> result; // bit 0: the line is inconsistent, bit 1: the blank is inconsistent
+
+	while (true) {
+		bool updated = false;
+		int next = 0;
+		while (next < static_cast<int>(edges.size())) {
+			batch.clear();
+			for (; next < static_cast<int>(edges.size()) && static_cast<int>(batch.size()) < batch_size; ++next) {
+				if (grid->GetEdge(edges[next]) == T::kEdgeUndecided) batch.push_back(next);
+			}
+			if (batch.empty()) break;
+
+			result.assign(batch.size(), 0);
+			pool->ParallelFor(static_cast<int>(batch.size()), [&](int worker, int i) {
+				T &field_line = fields_line[worker], &field_blank = fields_blank[worker];
+				if (worker_version[worker] != version) {
+					field_line = *grid;
+					field_blank = *grid;
+					worker_version[worker] = version;
+				}
+				field_line.AddRestorePoint();
+				field_blank.AddRestorePoint();
+				field_line.DecideEdge(edges[batch[i]], T::kEdgeLine);
+				field_blank.DecideEdge(edges[batch[i]], T::kEdgeBlank);
+				result[i] = (field_line.IsInconsistent() ? 1 : 0) | (field_blank.IsInconsistent() ? 2 : 0);
+				field_line.Rollback();
+				field_blank.Rollback();
+			});
+
+			for (int i = 0; i < static_cast<int>(batch.size()); ++i) {
+				if (result[i] == 0) continue;
+				if (result[i] == 3) {
+					grid->SetInconsistent();
+					return;
+				}
+				grid->DecideEdge(edges[batch[i]], result[i] == 1 ? T::kEdgeBlank : T::kEdgeLine);
+				++version;
+				updated = true;
+				// The edges after this one have to be tried again against the updated field
+				next = batch[i] + 1;
+				break;
+			}
+		}
+		if (!updated) break;
+	}
+}
 }
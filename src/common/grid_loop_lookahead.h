@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "grid_loop.h"
+
+namespace penciloid
+{
+// Settings of Lookahead(grid, option).
+struct LookaheadOption
+{
+	enum Ordering
+	{
+		kOrderRowMajor,        // the same order as Assume(grid)
+		kOrderDecidedNeighbors // edges with more decided edges around first (ties are broken in the row-major order)
+	};
+
+	LookaheadOption() : depth(1), max_probes(0), time_limit(0.0), ordering(kOrderRowMajor) {}
+
+	// The maximum number of nested assumptions. 1 is equivalent to Assume(grid).
+	int depth;
+
+	// The maximum number of probes (decisions of an edge under an assumption), or 0 for no limit.
+	long long max_probes;
+
+	// The time limit in seconds, or 0 for no limit.
+	// Note that the result depends on the speed of the machine if this is set.
+	double time_limit;
+
+	Ordering ordering;
+};
+struct LookaheadResult
+{
+	LookaheadResult() : n_probes(0), depth_required(0), budget_exhausted(false) {}
+
+	// The number of probes done in total (including nested ones)
+	long long n_probes;
+
+	// The largest depth at which an edge of the field was decided, or 0 if no edge was decided.
+	// Since shallower deductions are always tried first, this is a measure of the difficulty of the field.
+	int depth_required;
+
+	// True if the lookahead stopped due to <max_probes> or <time_limit>
+	bool budget_exhausted;
+};
+
+namespace lookahead_internal
+{
+template <class T>
+class Engine
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	Engine(const LookaheadOption &option) : option_(option), result_(), deadline_() {
+		if (option.time_limit > 0) {
+			deadline_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(option.time_limit));
+		}
+	}
+
+	// Decides the edges of <grid> which are forced at depth <depth> or less, until no more edge is decided.
+	// Shallower depths are tried first, and the search goes back to depth 1 whenever an edge is decided.
+	// If <top_level> is set, the depth of each deduction is recorded in the result.
+	void Closure(T *grid, int depth, bool top_level) {
+		int level = 1;
+		while (level <= depth) {
+			if (grid->IsInconsistent() || grid->IsFullySolved() || result_.budget_exhausted) return;
+			if (Pass(grid, level)) {
+				if (top_level) result_.depth_required = std::max(result_.depth_required, level);
+				level = 1;
+			} else {
+				++level;
+			}
+		}
+	}
+
+	const LookaheadResult &result() const { return result_; }
+
+private:
+	// Tries every undecided edge once at depth <level>. Returns true if any edge was decided.
+	bool Pass(T *grid, int level) {
+		std::vector<LoopPosition> candidates;
+		EnumerateCandidates(grid, &candidates);
+
+		bool updated = false;
+		for (LoopPosition edge : candidates) {
+			if (grid->GetEdge(edge) != T::kEdgeUndecided) continue;
+
+			for (auto status : { T::kEdgeLine, T::kEdgeBlank }) {
+				if (!ConsumeBudget()) return updated;
+				if (Refuted(grid, edge, status, level)) {
+					grid->DecideEdge(edge, status == T::kEdgeLine ? T::kEdgeBlank : T::kEdgeLine);
+					updated = true;
+					break;
+				}
+			}
+			if (grid->IsInconsistent()) return true;
+		}
+		return updated;
+	}
+
+	// Returns true if setting <edge> to <status> leads to a contradiction within <level> nested assumptions.
+	bool Refuted(T *grid, LoopPosition edge, typename T::EdgeState status, int level) {
+		grid->AddRestorePoint();
+		grid->DecideEdge(edge, status);
+		if (level > 1) Closure(grid, level - 1, false);
+		bool ret = grid->IsInconsistent();
+		grid->Rollback();
+		return ret;
+	}
+
+	void EnumerateCandidates(T *grid, std::vector<LoopPosition> *candidates) {
+		Y height = grid->GridLoop<T>::height();
+		X width = grid->GridLoop<T>::width();
+		for (Y y(0); y <= height * 2; ++y) {
+			for (X x(0); x <= width * 2; ++x) {
+				if (static_cast<int>(y % 2) != static_cast<int>(x % 2) && grid->GetEdge(LoopPosition(y, x)) == T::kEdgeUndecided) {
+					candidates->push_back(LoopPosition(y, x));
+				}
+			}
+		}
+		if (option_.ordering == LookaheadOption::kOrderDecidedNeighbors) {
+			// The edges sharing a vertex or a cell with the edge
+			static const Direction neighbors[] = {
+				Direction(Y(-2), X(0)), Direction(Y(2), X(0)), Direction(Y(0), X(-2)), Direction(Y(0), X(2)),
+				Direction(Y(-1), X(-1)), Direction(Y(-1), X(1)), Direction(Y(1), X(-1)), Direction(Y(1), X(1))
+			};
+			std::vector<std::pair<int, LoopPosition> > keyed;
+			for (LoopPosition edge : *candidates) {
+				int n_decided = 0;
+				for (Direction d : neighbors) {
+					if (grid->GetEdgeSafe(edge + d) == T::kEdgeLine || grid->GetEdgeSafe(edge + d) == T::kEdgeBlank) ++n_decided;
+				}
+				keyed.push_back({ -n_decided, edge });
+			}
+			std::stable_sort(keyed.begin(), keyed.end(), [](const std::pair<int, LoopPosition> &a, const std::pair<int, LoopPosition> &b) { return a.first < b.first; });
+			for (std::size_t i = 0; i < keyed.size(); ++i) (*candidates)[i] = keyed[i].second;
+		}
+	}
+
+	bool ConsumeBudget() {
+		if (result_.budget_exhausted) return false;
+		if ((option_.max_probes > 0 && result_.n_probes >= option_.max_probes) || (option_.time_limit > 0 && Clock::now() >= deadline_)) {
+			result_.budget_exhausted = true;
+			return false;
+		}
+		++result_.n_probes;
+		return true;
+	}
+
+	const LookaheadOption &option_;
+	LookaheadResult result_;
+	Clock::time_point deadline_;
+};
+}
+
+// Generalization of Assume(grid): the edges of <grid> are decided by trying each status of them and looking for a contradiction,
+// where up to (<option.depth> - 1) more assumptions may be nested inside a trial.
+template <class T>
+LookaheadResult Lookahead(T *grid, const LookaheadOption &option)
+{
+	lookahead_internal::Engine<T> engine(option);
+	engine.Closure(grid, option.depth, true);
+	return engine.result();
+}
+}
\ No newline at end of file
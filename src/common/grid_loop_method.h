@@ -5,7 +5,7 @@ namespace penciloid
 struct GridLoopMethod
 {
 	GridLoopMethod() : 
-		avoid_three_lines(true), avoid_line_cycle(true), eliminate_closed_chain(true), hourglass_rule1(true)
+		avoid_three_lines(true), avoid_line_cycle(true), eliminate_closed_chain(true), hourglass_rule1(true), prioritized_queue(false)
 	{}
 
 	void DisableAll()
@@ -19,5 +19,9 @@ struct GridLoopMethod
 	bool avoid_three_lines;
 	bool avoid_line_cycle, eliminate_closed_chain;
 	bool hourglass_rule1;
+
+	// Not a rule: if this is set, the positions are inspected in the order of GetInspectionLevel of the field
+	// instead of the FIFO order. This is not affected by DisableAll.
+	bool prioritized_queue;
 };
 }
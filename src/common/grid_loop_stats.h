@@ -0,0 +1,167 @@
+#pragma once
+
+#include <ostream>
+#include <iomanip>
+
+#ifdef PENCILOID_GRID_LOOP_STATS
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+namespace penciloid
+{
+// Deduction rules distinguished by the statistics. Except for kRuleOther, kRuleInspectVertex and kRuleJoin,
+// each of them corresponds to a flag of GridLoopMethod or slitherlink::Method.
+enum GridLoopRule
+{
+	kRuleOther,                // outside of any rule (e.g. DecideEdge called by the user)
+	kRuleInspectVertex,        // InspectVertex, except for the parts below
+	kRuleAvoidThreeLines,      // GridLoopMethod::avoid_three_lines
+	kRuleAvoidLineCycle,       // GridLoopMethod::avoid_line_cycle
+	kRuleHourglassRule1,       // GridLoopMethod::hourglass_rule1
+	kRuleJoin,                 // Join, except for the part below
+	kRuleEliminateClosedChain, // GridLoopMethod::eliminate_closed_chain
+	kRuleAroundCell,           // slitherlink::Method::around_cell (dictionary lookups)
+	kRuleAdjacent3,            // slitherlink::Method::adjacent_3
+	kRuleDiagonal3,            // slitherlink::Method::diagonal_3
+	kRuleDiagonalChain,        // slitherlink::Method::diagonal_chain
+	kRuleAroundPair,           // slitherlink::Method::around_pair
+	kNumberOfGridLoopRules
+};
+
+inline const char *GridLoopRuleName(int rule)
+{
+	static const char *names[] = {
+		"other", "inspect_vertex", "avoid_three_lines", "avoid_line_cycle", "hourglass_rule1",
+		"join", "eliminate_closed_chain", "around_cell", "adjacent_3", "diagonal_3", "diagonal_chain",
+		"around_pair"
+	};
+	return names[rule];
+}
+
+// Counters of the basic operations of GridLoop and its subclasses, for finding where the propagation time goes.
+// They are updated only if PENCILOID_GRID_LOOP_STATS is defined, so that usual builds don't pay for them.
+struct GridLoopStats
+{
+	struct RuleStats
+	{
+		unsigned long long invocations;
+		unsigned long long hits;          // invocations in which this rule itself decided some edge
+		unsigned long long decided_edges; // edges decided while this rule was the innermost running one
+		unsigned long long cycles;        // time spent in this rule, including the nested rules
+	};
+
+	GridLoopStats() : current_rule(kRuleOther) { Reset(); }
+
+	unsigned long long decided_edges;      // edges decided by DecideChain
+	unsigned long long joins;              // chains merged by Join
+	unsigned long long vertex_inspections; // calls of InspectVertex
+	unsigned long long inspections;        // calls of Inspect of the subclass
+	unsigned long long queue_pushes;       // positions actually pushed into the queue (not already in it)
+	unsigned long long queue_pops;
+	RuleStats rules[kNumberOfGridLoopRules];
+
+	// The innermost running rule
+	GridLoopRule current_rule;
+
+	void Reset() {
+		decided_edges = joins = vertex_inspections = inspections = queue_pushes = queue_pops = 0;
+		for (RuleStats &r : rules) r.invocations = r.hits = r.decided_edges = r.cycles = 0;
+	}
+	GridLoopStats &operator+=(const GridLoopStats &other) {
+		decided_edges += other.decided_edges;
+		joins += other.joins;
+		vertex_inspections += other.vertex_inspections;
+		inspections += other.inspections;
+		queue_pushes += other.queue_pushes;
+		queue_pops += other.queue_pops;
+		for (int i = 0; i < kNumberOfGridLoopRules; ++i) {
+			rules[i].invocations += other.rules[i].invocations;
+			rules[i].hits += other.rules[i].hits;
+			rules[i].decided_edges += other.rules[i].decided_edges;
+			rules[i].cycles += other.rules[i].cycles;
+		}
+		return *this;
+	}
+
+	// Prints a table of the rules.
+	void PrintRules(std::ostream &stream) const {
+		stream << std::left << std::setw(24) << "rule" << std::right << std::setw(14) << "invocations" << std::setw(14) << "hits"
+			<< std::setw(14) << "decided_edges" << std::setw(18) << "cycles" << std::setw(14) << "cycles/call" << std::endl;
+		for (int i = 0; i < kNumberOfGridLoopRules; ++i) {
+			const RuleStats &r = rules[i];
+			stream << std::left << std::setw(24) << GridLoopRuleName(i) << std::right << std::setw(14) << r.invocations << std::setw(14) << r.hits
+				<< std::setw(14) << r.decided_edges << std::setw(18) << r.cycles
+				<< std::setw(14) << (r.invocations > 0 ? r.cycles / r.invocations : 0) << std::endl;
+		}
+	}
+};
+
+// The counters of the current thread.
+inline GridLoopStats &GetGridLoopStats()
+{
+	static thread_local GridLoopStats stats;
+	return stats;
+}
+}
+
+#ifdef PENCILOID_GRID_LOOP_STATS
+namespace penciloid
+{
+inline unsigned long long ReadCycleCounter()
+{
+#if defined(_MSC_VER) || (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Counts an invocation of <rule> and the time until the end of the scope.
+// A rule entered again directly inside itself (e.g. Join calling itself after deciding a chain) belongs to the outer invocation.
+class GridLoopRuleScope
+{
+public:
+	GridLoopRuleScope(GridLoopRule rule) : rule_(rule), outer_rule_(GetGridLoopStats().current_rule), reentered_(outer_rule_ == rule) {
+		if (reentered_) return;
+		GridLoopStats &stats = GetGridLoopStats();
+		++stats.rules[rule].invocations;
+		stats.current_rule = rule;
+		decided_edges_ = stats.rules[rule].decided_edges;
+		start_ = ReadCycleCounter();
+	}
+	~GridLoopRuleScope() {
+		if (reentered_) return;
+		GridLoopStats &stats = GetGridLoopStats();
+		stats.rules[rule_].cycles += ReadCycleCounter() - start_;
+		if (stats.rules[rule_].decided_edges != decided_edges_) ++stats.rules[rule_].hits;
+		stats.current_rule = outer_rule_;
+	}
+
+	GridLoopRuleScope(const GridLoopRuleScope &) = delete;
+	GridLoopRuleScope &operator=(const GridLoopRuleScope &) = delete;
+
+private:
+	GridLoopRule rule_, outer_rule_;
+	bool reentered_;
+	unsigned long long decided_edges_, start_;
+};
+}
+
+#define PENCILOID_GRID_LOOP_COUNT(counter) (++::penciloid::GetGridLoopStats().counter)
+#define PENCILOID_GRID_LOOP_COUNT_DECIDED_EDGE() do { \
+	::penciloid::GridLoopStats &stats_ = ::penciloid::GetGridLoopStats(); \
+	++stats_.decided_edges; \
+	++stats_.rules[stats_.current_rule].decided_edges; \
+} while (0)
+#define PENCILOID_GRID_LOOP_RULE(rule) ::penciloid::GridLoopRuleScope grid_loop_rule_scope_(rule)
+#else
+#define PENCILOID_GRID_LOOP_COUNT(counter) ((void)0)
+#define PENCILOID_GRID_LOOP_COUNT_DECIDED_EDGE() ((void)0)
+#define PENCILOID_GRID_LOOP_RULE(rule) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+namespace penciloid
+{
+// A counter of 64-bit hash values by open addressing (linear probing).
+// Clear() takes O(1), so one HashCounter can be reused for many short runs without reallocation.
+class HashCounter
+{
+public:
+	HashCounter() : slots_(), mask_(0), stamp_(1), size_(0) {}
+
+	HashCounter(const HashCounter &) = delete;
+	HashCounter(HashCounter &&) = delete;
+	HashCounter &operator=(const HashCounter &) = delete;
+	HashCounter &operator=(HashCounter &&) = delete;
+
+	// Removes all the entries and makes sure that <capacity> distinct keys can be stored.
+	void Clear(int capacity) {
+		std::size_t n_slots = 16;
+		while (n_slots < static_cast<std::size_t>(capacity) * 2) n_slots *= 2;
+		if (slots_.size() < n_slots) {
+			slots_.assign(n_slots, Slot());
+			mask_ = n_slots - 1;
+			stamp_ = 1;
+		} else if (++stamp_ == 0) {
+			// The stamps wrapped around: clear the slots actually
+			slots_.assign(slots_.size(), Slot());
+			stamp_ = 1;
+		}
+		size_ = 0;
+	}
+
+	int Get(unsigned long long key) const {
+		for (std::size_t i = key & mask_;; i = (i + 1) & mask_) {
+			const Slot &s = slots_[i];
+			if (s.stamp != stamp_) return 0;
+			if (s.key == key) return s.count;
+		}
+	}
+
+	// The number of distinct keys should not exceed the capacity given to Clear().
+	void Increment(unsigned long long key) {
+		for (std::size_t i = key & mask_;; i = (i + 1) & mask_) {
+			Slot &s = slots_[i];
+			if (s.stamp != stamp_) {
+				s.key = key;
+				s.count = 1;
+				s.stamp = stamp_;
+				++size_;
+				return;
+			}
+			if (s.key == key) {
+				++s.count;
+				return;
+			}
+		}
+	}
+
+	int size() const { return size_; }
+
+private:
+	struct Slot
+	{
+		Slot() : key(0), count(0), stamp(0) {}
+
+		unsigned long long key;
+		int count;
+		unsigned int stamp;
+	};
+
+	std::vector<Slot> slots_;
+	std::size_t mask_;
+	unsigned int stamp_;
+	int size_;
+};
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace penciloid
+{
+// A work-stealing scheduler of independent jobs.
+// Each worker has its own deque: it runs its newest job first and, when the deque is empty, steals the oldest job of another worker.
+// Jobs may push further jobs, so that a long-running job doesn't keep the other workers idle.
+class JobScheduler
+{
+public:
+	// A job receives the id of the worker running it.
+	typedef std::function<void(int)> Job;
+
+	JobScheduler(int n_workers) : queues_(), n_queued_(0), n_pending_(0), stop_(false), next_submit_(0) {
+		for (int i = 0; i < n_workers; ++i) queues_.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+
+	JobScheduler(const JobScheduler &) = delete;
+	JobScheduler(JobScheduler &&) = delete;
+	JobScheduler &operator=(const JobScheduler &) = delete;
+	JobScheduler &operator=(JobScheduler &&) = delete;
+
+	int size() const { return static_cast<int>(queues_.size()); }
+
+	// Adds <job> from outside of the workers. Jobs are distributed to the workers in a round-robin manner.
+	void Submit(Job job) {
+		Push(next_submit_, std::move(job));
+		next_submit_ = (next_submit_ + 1) % size();
+	}
+
+	// Adds <job> to the deque of <worker>. This can be called from the jobs.
+	void Push(int worker, Job job) {
+		++n_pending_;
+		{
+			std::lock_guard<std::mutex> lock(queues_[worker]->mutex);
+			queues_[worker]->jobs.push_back(std::move(job));
+		}
+		++n_queued_;
+		std::lock_guard<std::mutex> lock(mutex_);
+		cv_.notify_one();
+	}
+
+	// Drops all the queued jobs. Running jobs are not interrupted, and Run() returns after they finish.
+	void Stop() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+		cv_.notify_all();
+	}
+
+	// Runs the workers until all the jobs (including the ones pushed by jobs) finish, or Stop() is called.
+	void Run() {
+		std::vector<std::thread> threads;
+		for (int i = 1; i < size(); ++i) threads.push_back(std::thread(&JobScheduler::WorkerLoop, this, i));
+		WorkerLoop(0);
+		for (std::thread &th : threads) th.join();
+
+		for (auto &q : queues_) q->jobs.clear();
+		n_queued_ = 0;
+		n_pending_ = 0;
+	}
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	bool PopJob(int worker, Job *job) {
+		{
+			WorkerQueue &q = *queues_[worker];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (!q.jobs.empty()) {
+				*job = std::move(q.jobs.back());
+				q.jobs.pop_back();
+				--n_queued_;
+				return true;
+			}
+		}
+		for (int i = 1; i < size(); ++i) {
+			WorkerQueue &q = *queues_[(worker + i) % size()];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (!q.jobs.empty()) {
+				*job = std::move(q.jobs.front());
+				q.jobs.pop_front();
+				--n_queued_;
+				return true;
+			}
+		}
+		return false;
+	}
+	void WorkerLoop(int worker) {
+		for (;;) {
+			if (stop_) return;
+
+			Job job;
+			if (!PopJob(worker, &job)) {
+				std::unique_lock<std::mutex> lock(mutex_);
+				cv_.wait(lock, [this]() { return stop_ || n_queued_ > 0 || n_pending_ == 0; });
+				if (n_queued_ == 0 && n_pending_ == 0) return;
+				continue;
+			}
+
+			job(worker);
+			job = nullptr;
+			if (--n_pending_ == 0) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				cv_.notify_all();
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<WorkerQueue> > queues_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::atomic<int> n_queued_, n_pending_;
+	std::atomic<bool> stop_;
+	int next_submit_;
+};
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace penciloid
+{
+// A lock-free unbounded queue with multiple producers and a single consumer (the intrusive queue by D. Vyukov).
+// Push() may be called from any thread, while Pop() must be called only from one thread at a time.
+template <class T>
+class MpscQueue
+{
+public:
+	MpscQueue() : head_(nullptr), tail_(new Node()) { head_ = tail_; }
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue(MpscQueue &&) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+	MpscQueue &operator=(MpscQueue &&) = delete;
+
+	~MpscQueue() {
+		while (tail_) {
+			Node *next = tail_->next.load(std::memory_order_relaxed);
+			delete tail_;
+			tail_ = next;
+		}
+	}
+
+	void Push(T value) {
+		Node *node = new Node(std::move(value));
+		Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	// Returns false if the queue is empty (or the latest Push() is not finished yet).
+	bool Pop(T *value) {
+		Node *next = tail_->next.load(std::memory_order_acquire);
+		if (next == nullptr) return false;
+		*value = std::move(next->value);
+		delete tail_;
+		tail_ = next;
+		return true;
+	}
+
+	// Returns true if Pop() would fail now. This must be called only from the consumer.
+	bool Empty() const {
+		return tail_->next.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	// <tail_> is always a dummy node whose value is already popped (or the initial one)
+	struct Node
+	{
+		Node() : next(nullptr), value() {}
+		Node(T &&v) : next(nullptr), value(std::move(v)) {}
+
+		std::atomic<Node*> next;
+		T value;
+	};
+
+	std::atomic<Node*> head_;
+	Node *tail_;
+};
+}
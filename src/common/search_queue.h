@@ -1,33 +1,44 @@
 #pragma once
 
 #include "auto_array.h"
+#include "grid_loop_stats.h"
 
 namespace penciloid
 {
+// A queue of integers in [0, size) in which each element is stored at most once.
+// Elements can be pushed with a level: those of lower levels are popped first, and the ones of the same level are popped in the FIFO order.
+// Level 0 is a ring buffer. The other levels are linked lists, which are allocated when they are used for the first time.
 class SearchQueue
 {
 public:
-	SearchQueue() : queue_(), is_stored_(), size_(0), top_(-1), end_(-1) {}
-	SearchQueue(int size) : queue_(size + 1), is_stored_(size), size_(size + 1), top_(-1), end_(-1) {
-		std::fill(is_stored_.begin(), is_stored_.end(), false);
+	static const int kNumberOfLevels = 4;
+
+	SearchQueue() : queue_(), is_stored_(), next_(), size_(0), top_(-1), end_(-1), n_deferred_(0) { ClearDeferred(); }
+	SearchQueue(int size) : queue_(size + 1), is_stored_((size + kBitsPerWord - 1) / kBitsPerWord), next_(), size_(size + 1), top_(-1), end_(-1), n_deferred_(0) {
+		std::fill(is_stored_.begin(), is_stored_.end(), 0U);
+		ClearDeferred();
 	}
-	SearchQueue(const SearchQueue &other) : queue_(other.queue_), is_stored_(other.is_stored_), size_(other.size_), top_(-1), end_(-1) {}
-	SearchQueue(SearchQueue &&other) : queue_(std::move(other.queue_)), is_stored_(std::move(other.is_stored_)), size_(other.size_), top_(-1), end_(-1) {}
+	SearchQueue(const SearchQueue &other) : queue_(other.queue_), is_stored_(other.is_stored_), next_(), size_(other.size_), top_(-1), end_(-1), n_deferred_(0) { ClearDeferred(); }
+	SearchQueue(SearchQueue &&other) : queue_(std::move(other.queue_)), is_stored_(std::move(other.is_stored_)), next_(), size_(other.size_), top_(-1), end_(-1), n_deferred_(0) { ClearDeferred(); }
 
 	SearchQueue &operator=(const SearchQueue &other) {
 		queue_ = other.queue_;
 		is_stored_ = other.is_stored_;
+		next_ = other.next_;
 		size_ = other.size_;
 		top_ = other.top_;
 		end_ = other.end_;
+		CopyDeferred(other);
 		return *this;
 	}
 	SearchQueue &operator=(SearchQueue &&other) {
 		queue_ = std::move(other.queue_);
 		is_stored_ = std::move(other.is_stored_);
+		next_ = std::move(other.next_);
 		size_ = other.size_;
 		top_ = other.top_;
 		end_ = other.end_;
+		CopyDeferred(other);
 		return *this;
 	}
 	void Activate() {
@@ -41,24 +52,85 @@ public:
 		return top_ != -1;
 	}
 	void Push(int e) {
-		if (!is_stored_[e]) {
-			is_stored_[e] = true;
+		unsigned int &word = is_stored_[e / kBitsPerWord];
+		unsigned int bit = 1U << (e % kBitsPerWord);
+		if (!(word & bit)) {
+			PENCILOID_GRID_LOOP_COUNT(queue_pushes);
+			word |= bit;
+			queue_[end_++] = e;
+			if (end_ == size_) end_ = 0;
+		}
+	}
+	// Push <e> to the level <level> (0 <= <level> < kNumberOfLevels).
+	void Push(int e, int level) {
+		if (level == 0) {
+			Push(e);
+			return;
+		}
+		unsigned int &word = is_stored_[e / kBitsPerWord];
+		unsigned int bit = 1U << (e % kBitsPerWord);
+		if (word & bit) return;
+		PENCILOID_GRID_LOOP_COUNT(queue_pushes);
+		word |= bit;
+		if (next_.begin() == nullptr) next_ = AutoArray<int>(size_);
+		next_[e] = -1;
+		if (deferred_tail_[level] == -1) deferred_head_[level] = e;
+		else next_[deferred_tail_[level]] = e;
+		deferred_tail_[level] = e;
+		++n_deferred_;
+	}
+	// Push <first>, <first> + <step>, ... (less than <last>) in this order.
+	// This is equivalent to calling Push for each of them, but runs in a single pass without any other checks.
+	void PushRange(int first, int last, int step) {
+		for (int e = first; e < last; e += step) {
+			unsigned int &word = is_stored_[e / kBitsPerWord];
+			unsigned int bit = 1U << (e % kBitsPerWord);
+			if (word & bit) continue;
+			PENCILOID_GRID_LOOP_COUNT(queue_pushes);
+			word |= bit;
 			queue_[end_++] = e;
 			if (end_ == size_) end_ = 0;
 		}
 	}
 	int Pop() {
-		int ret = queue_[top_++];
-		is_stored_[ret] = false;
-		if (top_ == size_) top_ = 0;
+		PENCILOID_GRID_LOOP_COUNT(queue_pops);
+		int ret;
+		if (top_ != end_) {
+			ret = queue_[top_++];
+			if (top_ == size_) top_ = 0;
+		} else {
+			int level = 1;
+			while (deferred_head_[level] == -1) ++level;
+			ret = deferred_head_[level];
+			deferred_head_[level] = next_[ret];
+			if (deferred_head_[level] == -1) deferred_tail_[level] = -1;
+			--n_deferred_;
+		}
+		is_stored_[ret / kBitsPerWord] &= ~(1U << (ret % kBitsPerWord));
 		return ret;
 	}
 	bool IsEmpty() const {
-		return top_ == end_;
+		return top_ == end_ && n_deferred_ == 0;
 	}
 private:
+	void ClearDeferred() {
+		std::fill(deferred_head_, deferred_head_ + kNumberOfLevels, -1);
+		std::fill(deferred_tail_, deferred_tail_ + kNumberOfLevels, -1);
+	}
+	void CopyDeferred(const SearchQueue &other) {
+		std::copy(other.deferred_head_, other.deferred_head_ + kNumberOfLevels, deferred_head_);
+		std::copy(other.deferred_tail_, other.deferred_tail_ + kNumberOfLevels, deferred_tail_);
+		n_deferred_ = other.n_deferred_;
+	}
+
+	// is_stored_ is a bitset of the elements in the queue
+	static const int kBitsPerWord = 32;
+
 	AutoArray<int> queue_;
-	AutoArray<bool> is_stored_;
+	AutoArray<unsigned int> is_stored_;
+	// The next element in the same level (for levels other than 0)
+	AutoArray<int> next_;
 	int size_, top_, end_;
+	int deferred_head_[kNumberOfLevels], deferred_tail_[kNumberOfLevels], n_deferred_;
 };
 }
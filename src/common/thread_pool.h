@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace penciloid
+{
+// A fixed set of worker threads which repeatedly run parallel loops.
+// The calling thread also works as the worker #0, so ThreadPool(1) doesn't create any thread.
+class ThreadPool
+{
+public:
+	ThreadPool(int n_workers) : threads_(), task_(nullptr), n_tasks_(0), next_task_(0), generation_(0), n_running_(0), terminate_(false) {
+		for (int i = 1; i < n_workers; ++i) {
+			threads_.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+		}
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool(ThreadPool &&) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	ThreadPool &operator=(ThreadPool &&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			terminate_ = true;
+		}
+		cv_start_.notify_all();
+		for (std::thread &th : threads_) th.join();
+	}
+
+	int size() const { return static_cast<int>(threads_.size()) + 1; }
+
+	// Calls <func(worker, index)> for every index in [0, n_tasks), and returns after all the calls finished.
+	// Indices are handed out to the workers in increasing order.
+	// Calls with the same <worker> never run concurrently, so <worker> can be used to select per-thread data.
+	void ParallelFor(int n_tasks, const std::function<void(int, int)> &func) {
+		if (threads_.empty()) {
+			for (int i = 0; i < n_tasks; ++i) func(0, i);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			task_ = &func;
+			n_tasks_ = n_tasks;
+			next_task_ = 0;
+			n_running_ = static_cast<int>(threads_.size());
+			++generation_;
+		}
+		cv_start_.notify_all();
+		RunTasks(0);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_done_.wait(lock, [this]() { return n_running_ == 0; });
+		task_ = nullptr;
+	}
+
+private:
+	void RunTasks(int worker) {
+		for (;;) {
+			int idx = next_task_.fetch_add(1);
+			if (idx >= n_tasks_) break;
+			(*task_)(worker, idx);
+		}
+	}
+	void WorkerLoop(int worker) {
+		int last_generation = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				cv_start_.wait(lock, [this, last_generation]() { return terminate_ || generation_ != last_generation; });
+				if (terminate_) return;
+				last_generation = generation_;
+			}
+			RunTasks(worker);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (--n_running_ == 0) cv_done_.notify_one();
+			}
+		}
+	}
+
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable cv_start_, cv_done_;
+	const std::function<void(int, int)> *task_;
+	int n_tasks_;
+	std::atomic<int> next_task_;
+	int generation_;
+	int n_running_;
+	bool terminate_;
+};
+}
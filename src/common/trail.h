@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace penciloid
+{
+// An undo log with nested checkpoints for fields which consist of an array of <Entry> and a small <State> (counters, flags).
+// A checkpoint costs O(1): only <State> and the length of the log are saved.
+// Each change of the array should be reported by Save(index, previous value) before it is made.
+// Since the entries refer to the array by index, a Trail can be copied along with the field.
+template <class Entry, class State>
+class Trail
+{
+public:
+	Trail() : log_(), checkpoints_() {}
+
+	// Changes have to be saved only if there is a checkpoint.
+	bool IsActive() const { return !checkpoints_.empty(); }
+
+	void AddCheckpoint(const State &state) { checkpoints_.push_back({ log_.size(), state }); }
+
+	void Save(int index, const Entry &value) {
+		if (IsActive()) log_.push_back({ index, value });
+	}
+
+	// Undo the changes after the last checkpoint by calling <restore(index, value)> in the reverse order,
+	// and return the state saved at the checkpoint.
+	template <class F>
+	State Rollback(F restore) {
+		Checkpoint last = checkpoints_.back();
+		checkpoints_.pop_back();
+		while (log_.size() > last.log_size) {
+			restore(log_.back().first, log_.back().second);
+			log_.pop_back();
+		}
+		return last.state;
+	}
+
+	// Remove the last checkpoint without undoing the changes.
+	// They will be undone by the rollback to the previous checkpoint (if any).
+	void DiscardCheckpoint() {
+		checkpoints_.pop_back();
+		if (checkpoints_.empty()) log_.clear();
+	}
+
+private:
+	struct Checkpoint
+	{
+		std::size_t log_size;
+		State state;
+	};
+
+	std::vector<std::pair<int, Entry> > log_;
+	std::vector<Checkpoint> checkpoints_;
+};
+}
\ No newline at end of file
@@ -23,4 +23,13 @@ inline int PopCount(unsigned int n)
 #endif
 #endif
 }
+
+// Scrambles the bits of <x> (the finalizer of SplitMix64). Useful for deriving Zobrist keys.
+inline unsigned long long MixBits(unsigned long long x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
 }
\ No newline at end of file
@@ -4,13 +4,22 @@
 #include <random>
 #include <sstream>
 #include <thread>
+#include <map>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
 
 #include "slitherlink/sl_dictionary.h"
 #include "slitherlink/sl_generator.h"
 #include "slitherlink/sl_generator_option.h"
 #include "slitherlink/sl_clue_placement.h"
 #include "slitherlink/sl_problem.h"
+#include "common/job_scheduler.h"
+#include "common/mpsc_queue.h"
+#include "common/grid_loop_stats.h"
 
 namespace
 {
@@ -24,6 +33,8 @@ void ShowUsage(int argc, char** argv)
   -pl            Output in the Penciloid format\n\
   -n <num>       Generate <num> problems under the given setting\n\
   -p <threads>   Generate problems using <threads> threads\n\
+  -j <threads>   Evaluate the candidates of each step using <threads> threads\n\
+  -J <threads>   Run the trial-and-error technique (-t) using <threads> threads (ignored with -j, --depth or --probes)\n\
   -a             Append to the output file\n\
   -c             Generate the clue placement automatically\n\
   -h <height>    Set the height of the problem <height>\n\
@@ -32,47 +43,55 @@ void ShowUsage(int argc, char** argv)
   -M <num>       Set the maximum number of the clues <num>\n\
   -s <symmetry>  Specify the symmetry of the clue placement\n\
   -t             Use the trial-and-error technique\n\
+  --depth <num>  Allow <num> nested assumptions in the trial-and-error technique (1 by default)\n\
+  --probes <num> Limit the number of trials by the trial-and-error technique to <num> per placed clue\n\
+  --seed <seed>  Generate reproducibly from <seed>\n\
+  --start <idx>  Number the problems from <idx> in the reproducible mode (0 by default)\n\
+  --dictionary <file>\n\
+                 Load the dictionary from <file>, which is created if missing or outdated\n\
+  --pair-table   Also use the deductions on pairs of adjacent clues\n\
 \n\
 Options -h, -w, -m, -M and -s are valid only if -c is specified.\n\
 -a is automatically set if -n is specified.\n\
-If -c is not specified, the input file should be specified for the clue placement." << std::endl;
+If -c is not specified, the input file should be specified for the clue placement.\n\
+With --seed, the k-th problem depends only on <seed>, k and the options other than -p, -j and -J,\n\
+so a batch can be split into several runs by --start.\n\
+If built with -DPENCILOID_GRID_LOOP_STATS, the statistics of the deduction rules are printed to stderr at the end\n\
+(except for the work done by the threads of -j)." << std::endl;
 }
-bool GenerateWithCluePlacement(
-	penciloid::slitherlink::CluePlacement &placement, 
-	penciloid::slitherlink::GeneratorOption &opt, 
-	std::mt19937 *rnd, 
-	penciloid::slitherlink::Problem *problem,
-	int n_trial = -1)
-{
-	if (n_trial < 0) {
-		while (!penciloid::slitherlink::GenerateByLocalSearch(placement, opt, rnd, problem));
-		return true;
-	}
-	while (n_trial) {
-		if (penciloid::slitherlink::GenerateByLocalSearch(placement, opt, rnd, problem)) {
-			return true;
-		}
-		--n_trial;
-	}
-	return false;
-}
-void GenerateAuto(
-	int height, 
-	int width, 
-	int n_clue_lo, 
-	int n_clue_hi, 
-	int symmetry, 
-	penciloid::slitherlink::GeneratorOption &opt,
-	std::mt19937 *rnd, 
-	penciloid::slitherlink::Problem *problem)
+// Each attempt on a clue placement is a job. An auto-generated placement is given up after this number of failed attempts.
+const int kAttemptsPerAutoPlacement = 3;
+// Appends <problem> to <out> in the PencilBox format, or in the Penciloid format if <penciloid_format> is set.
+void FormatProblem(const penciloid::slitherlink::Problem &problem, bool penciloid_format, std::string *out)
 {
 	using namespace penciloid;
 	using namespace slitherlink;
-	for (;;) {
-		int n_clues = std::uniform_int_distribution<int>(n_clue_lo, n_clue_hi)(*rnd);
-		CluePlacement placement = GenerateCluePlacement(Y(height), X(width), n_clues, symmetry, rnd);
-		if (GenerateWithCluePlacement(placement, opt, rnd, problem, 3)) {
-			break;
+	Y height = problem.height();
+	X width = problem.width();
+
+	if (penciloid_format) {
+		*out += std::to_string(static_cast<int>(height)) + " " + std::to_string(static_cast<int>(width)) + "\n";
+		for (Y y(0); y < height; ++y) {
+			for (X x(0); x < width; ++x) {
+				Clue c = problem.GetClue(CellPosition(y, x));
+				if (c == kNoClue) *out += '.';
+				else *out += static_cast<char>('0' + static_cast<int>(c));
+			}
+			*out += '\n';
+		}
+		*out += '\n';
+	} else {
+		*out += std::to_string(static_cast<int>(height)) + "\n" + std::to_string(static_cast<int>(width)) + "\n";
+		for (Y y(0); y < height; ++y) {
+			for (X x(0); x < width; ++x) {
+				Clue c = problem.GetClue(CellPosition(y, x));
+				if (c == kNoClue) *out += ". ";
+				else {
+					*out += static_cast<char>('0' + static_cast<int>(c));
+					*out += ' ';
+				}
+			}
+			*out += '\n';
 		}
 	}
 }
@@ -110,11 +129,20 @@ int main(int argc, char** argv)
 	int height = -1, width = -1, n_clue_lo = -1, n_clue_hi = -1, symmetry = 0;
 	int n_problems = 1;
 	int n_threads = 1;
+	int n_evaluation_threads = 1;
+	int n_assumption_threads = 1;
 
 	bool gen_clue_auto = false;
 	bool append_to_output = false;
 	bool output_in_penciloid_format = false;
 	bool use_trial_and_error = false;
+	bool reproducible = false;
+	unsigned long long seed = 0;
+	int start_index = 0;
+	std::string dictionary_filename;
+	bool use_pair_table = false;
+	int assumption_depth = 1;
+	long long assumption_max_probes = 0;
 
 	// parse options
 	int arg_idx = 1;
@@ -156,7 +184,7 @@ int main(int argc, char** argv)
 			} else {
 				symmetry = ParseSymmetry(opt.substr(2));
 			}
-		} else if (opt[1] == 'h' || opt[1] == 'w' || opt[1] == 'm' || opt[1] == 'M' || opt[1] == 'n' || opt[1] == 'p') {
+		} else if (opt[1] == 'h' || opt[1] == 'w' || opt[1] == 'm' || opt[1] == 'M' || opt[1] == 'n' || opt[1] == 'p' || opt[1] == 'j' || opt[1] == 'J') {
 			std::istringstream iss;
 			if (opt.size() == 2) {
 				if (arg_idx + 1 >= argc) {
@@ -182,7 +210,59 @@ int main(int argc, char** argv)
 			case 'M': n_clue_hi = val; break;
 			case 'n': n_problems = val; append_to_output = true; break;
 			case 'p': n_threads = val; break;
+			case 'j': n_evaluation_threads = val; break;
+			case 'J': n_assumption_threads = val; break;
+			}
+		} else if (opt == "--seed" || opt == "--start") {
+			if (arg_idx + 1 >= argc) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+			std::istringstream iss(argv[arg_idx + 1]);
+			++arg_idx;
+			if (opt == "--seed") {
+				iss >> seed;
+				reproducible = true;
+			} else {
+				iss >> start_index;
+			}
+			if (iss.fail()) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+		} else if (opt == "--depth" || opt == "--probes") {
+			if (arg_idx + 1 >= argc) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+			std::istringstream iss(argv[arg_idx + 1]);
+			if (opt == "--depth") {
+				iss >> assumption_depth;
+			} else {
+				iss >> assumption_max_probes;
+			}
+			if (iss.fail() || !(iss >> std::ws).eof()) {
+				std::cerr << "error: invalid value '" << argv[arg_idx + 1] << "' for " << opt << std::endl;
+				return 0;
+			}
+			++arg_idx;
+			if (opt == "--depth" && assumption_depth < 1) {
+				std::cerr << "error: --depth must be at least 1" << std::endl;
+				return 0;
+			}
+			if (opt == "--probes" && assumption_max_probes < 0) {
+				std::cerr << "error: --probes must not be negative" << std::endl;
+				return 0;
 			}
+		} else if (opt == "--pair-table") {
+			use_pair_table = true;
+		} else if (opt == "--dictionary") {
+			if (arg_idx + 1 >= argc) {
+				std::cerr << "error: missing value after " << opt << std::endl;
+				return 0;
+			}
+			dictionary_filename = argv[arg_idx + 1];
+			++arg_idx;
 		} else if (opt == "--help") {
 			ShowUsage(argc, argv);
 			return 0;
@@ -211,11 +291,20 @@ int main(int argc, char** argv)
 
 	GeneratorOption opt;
 	Dictionary dic;
-	dic.CreateDefault();
+	bool dictionary_ready;
+	if (dictionary_filename.empty()) dictionary_ready = dic.CreateDefault(std::max(n_threads, 1));
+	else dictionary_ready = dic.LoadOrCreate(dictionary_filename, DictionaryMethod(), std::max(n_threads, 1));
+	if (!dictionary_ready) {
+		std::cerr << "error: failed to create the dictionary" << std::endl;
+		return 1;
+	}
+	if (use_pair_table) dic.CreatePairTable();
 	opt.field_dictionary = &dic;
 	opt.use_assumption = use_trial_and_error;
-
-	std::ofstream *ofs = nullptr;
+	opt.assumption.depth = assumption_depth;
+	opt.assumption.max_probes = assumption_max_probes;
+	opt.n_evaluation_threads = n_evaluation_threads;
+	opt.n_assumption_threads = n_assumption_threads;
 
 	CluePlacement clue_placement;
 	if (!gen_clue_auto) {
@@ -251,75 +340,160 @@ int main(int argc, char** argv)
 		}
 	}
 
-	std::mutex mtx;
-	int gen_problems = 0;
+	if (gen_clue_auto && (n_clue_lo == -1 || n_clue_hi == -1)) {
+		n_clue_lo = static_cast<int>(height * width * 0.3);
+		n_clue_hi = static_cast<int>(height * width * 0.4);
+	}
+	if (out_filename.empty()) {
+		out_filename = in_filename + ".generated.txt";
+	}
+	std::ofstream ofs(out_filename, append_to_output ? std::ios::app : std::ios::out);
+	if (!ofs.good()) {
+		std::cerr << "error: couldn't open file '" << out_filename << "'" << std::endl;
+		return 0;
+	}
 
-	auto worker = [&]() {
-		Problem problem;
+	// Problems are generated by chains of attempts. The generator of an attempt is seeded by <base_seed>,
+	// the index of its chain and the number of preceding attempts in the chain.
+	// In the reproducible mode, the k-th chain makes exactly the k-th problem.
+	std::vector<unsigned int> base_seed;
+	if (reproducible) {
+		base_seed.push_back(static_cast<unsigned int>(seed));
+		base_seed.push_back(static_cast<unsigned int>(seed >> 32));
+	} else {
 		std::random_device dev;
-		std::vector<int> seed(10);
-		std::generate(seed.begin(), seed.end(), std::ref(dev));
-		std::seed_seq seq(seed.begin(), seed.end());
-		std::mt19937 rnd(seq);
-		for (;;) {
-			if (!gen_clue_auto) {
-				GenerateWithCluePlacement(clue_placement, opt, &rnd, &problem);
-			} else {
-				if (n_clue_lo == -1 || n_clue_hi == -1) {
-					n_clue_lo = static_cast<int>(height * width * 0.3);
-					n_clue_hi = static_cast<int>(height * width * 0.4);
-				}
-				GenerateAuto(height, width, n_clue_lo, n_clue_hi, symmetry, opt, &rnd, &problem);
-			}
+		base_seed.resize(8);
+		std::generate(base_seed.begin(), base_seed.end(), std::ref(dev));
+	}
+	auto attempt_random = [&](int chain, int attempt_index) {
+		std::vector<unsigned int> seq_base = base_seed;
+		seq_base.push_back(static_cast<unsigned int>(chain));
+		seq_base.push_back(static_cast<unsigned int>(attempt_index));
+		std::seed_seq seq(seq_base.begin(), seq_base.end());
+		return std::mt19937(seq);
+	};
 
-			mtx.lock();
-			if (out_filename.empty()) {
-				out_filename = in_filename + ".generated.txt";
-			}
-			if (ofs == nullptr) {
-				ofs = new std::ofstream(out_filename, append_to_output ? std::ios::app : std::ios::out);
-				if (!ofs->good()) {
-					std::cerr << "error: couldn't open file '" << in_filename << "'" << std::endl;
-					return 0;
-				}
-			}
-			if (output_in_penciloid_format) {
-				*ofs << height << " " << width << std::endl;
-				for (Y y(0); y < height; ++y) {
-					for (X x(0); x < width; ++x) {
-						Clue c = problem.GetClue(CellPosition(y, x));
-						if (c == kNoClue) *ofs << ".";
-						else *ofs << static_cast<int>(c);
-					}
-					*ofs << std::endl;
+	n_threads = std::max(n_threads, 1);
+	JobScheduler scheduler(n_threads);
+	std::shared_ptr<const CluePlacement> fixed_placement;
+	if (!gen_clue_auto) fixed_placement = std::make_shared<const CluePlacement>(clue_placement);
+	std::atomic<int> gen_problems(0);
+	std::atomic<int> n_chains(0);
+	// Returns the index of a new chain, or -1 if all the chains are already started in the reproducible mode
+	auto new_chain = [&]() -> int {
+		int k = n_chains++;
+		if (reproducible) return k < n_problems ? start_index + k : -1;
+		return k;
+	};
+
+	// Finished problems are written by <writer>, so that the workers never wait for the output
+	// Each problem is queued with its index, and written in the order of the indices.
+	// The writer sleeps on <output_cv> until a problem is queued or the generation finishes.
+	MpscQueue<std::pair<int, std::string> > output_queue;
+	std::mutex output_mtx;
+	std::condition_variable output_cv;
+	bool generation_finished = false; // guarded by <output_mtx>
+	auto push_output = [&](int index, std::string &&text) {
+		output_queue.Push({ index, std::move(text) });
+		// Taking the lock makes sure that the writer is either waiting (and woken up) or going to see the problem
+		{ std::lock_guard<std::mutex> lock(output_mtx); }
+		output_cv.notify_one();
+	};
+	std::thread writer([&]() {
+		const std::size_t kWriteSize = 1 << 16;
+		std::string buffer;
+		std::pair<int, std::string> item;
+		std::map<int, std::string> waiting;
+		int next_index = 0;
+		for (;;) {
+			while (output_queue.Pop(&item)) {
+				waiting.insert(std::move(item));
+				for (auto it = waiting.begin(); it != waiting.end() && it->first == next_index; it = waiting.erase(it)) {
+					buffer += it->second;
+					++next_index;
 				}
-				*ofs << std::endl;
-			} else {
-				*ofs << height << std::endl;
-				*ofs << width << std::endl;
-				for (Y y(0); y < height; ++y) {
-					for (X x(0); x < width; ++x) {
-						Clue c = problem.GetClue(CellPosition(y, x));
-						if (c == kNoClue) *ofs << ". ";
-						else *ofs << static_cast<int>(c) << " ";
-					}
-					*ofs << std::endl;
+				if (buffer.size() >= kWriteSize) {
+					ofs.write(buffer.data(), buffer.size());
+					buffer.clear();
 				}
 			}
-			if (++gen_problems == n_problems) {
-				mtx.unlock();
-				break;
+			std::unique_lock<std::mutex> lock(output_mtx);
+			output_cv.wait(lock, [&]() { return generation_finished || !output_queue.Empty(); });
+			if (generation_finished && output_queue.Empty()) break;
+		}
+		ofs.write(buffer.data(), buffer.size());
+		ofs.flush();
+	});
+
+	// Propagation statistics of the finished attempts (collected only if PENCILOID_GRID_LOOP_STATS is defined)
+	std::mutex stats_mtx;
+	GridLoopStats propagation_stats;
+
+	// Tries to generate a problem once with <placement> (or a new one if it is null), and pushes the next attempt of the chain on failure.
+	std::function<void(int, int, int, std::shared_ptr<const CluePlacement>, int)> attempt;
+	attempt = [&](int worker, int chain, int attempt_index, std::shared_ptr<const CluePlacement> placement, int n_attempts_left) {
+		std::mt19937 rnd = attempt_random(chain, attempt_index);
+		if (!placement) {
+			int n_clues = std::uniform_int_distribution<int>(n_clue_lo, n_clue_hi)(rnd);
+			placement = std::make_shared<const CluePlacement>(GenerateCluePlacement(Y(height), X(width), n_clues, symmetry, &rnd));
+			n_attempts_left = kAttemptsPerAutoPlacement;
+		}
+
+		Problem problem;
+		bool generated = GenerateByLocalSearch(*placement, opt, &rnd, &problem);
+#ifdef PENCILOID_GRID_LOOP_STATS
+		{
+			std::lock_guard<std::mutex> lock(stats_mtx);
+			propagation_stats += GetGridLoopStats();
+			GetGridLoopStats().Reset();
+		}
+#endif
+		if (!generated) {
+			if (gen_clue_auto && --n_attempts_left == 0) placement = nullptr;
+			scheduler.Push(worker, [&attempt, chain, attempt_index, placement, n_attempts_left](int w) {
+				attempt(w, chain, attempt_index + 1, placement, n_attempts_left);
+			});
+			return;
+		}
+
+		std::string text;
+		text.reserve((static_cast<int>(height) * 2 + 1) * (static_cast<int>(width) + 1) + 16);
+		FormatProblem(problem, output_in_penciloid_format, &text);
+
+		if (reproducible) {
+			push_output(chain - start_index, std::move(text));
+		} else {
+			int problem_id = gen_problems++;
+			if (problem_id >= n_problems) return;
+			push_output(problem_id, std::move(text));
+
+			if (problem_id + 1 == n_problems) {
+				scheduler.Stop();
+				return;
 			}
-			mtx.unlock();
 		}
+
+		// The finished chain is replaced by a new one, so that <n_threads> chains are in flight while problems are still needed
+		int next = new_chain();
+		if (next >= 0) scheduler.Push(worker, [&attempt, &fixed_placement, next](int w) { attempt(w, next, 0, fixed_placement, -1); });
 	};
-	std::vector<std::thread> threads;
-	n_threads = std::min(n_threads, n_problems);
+
 	for (int i = 0; i < n_threads; ++i) {
-		threads.push_back(std::thread(worker));
+		int chain = new_chain();
+		if (chain < 0) break;
+		scheduler.Submit([&attempt, &fixed_placement, chain](int w) { attempt(w, chain, 0, fixed_placement, -1); });
+	}
+	scheduler.Run();
+
+	{
+		std::lock_guard<std::mutex> lock(output_mtx);
+		generation_finished = true;
 	}
-	for (int i = 0; i < n_threads; ++i) threads[i].join();
+	output_cv.notify_one();
+	writer.join();
 
-	if (ofs) delete ofs;
+#ifdef PENCILOID_GRID_LOOP_STATS
+	propagation_stats.PrintRules(std::cerr);
+#endif
 	return 0;
 }
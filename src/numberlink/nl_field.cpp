@@ -4,16 +4,16 @@ namespace penciloid
 {
 namespace numberlink
 {
-Field::Field() : history_(), mate_(), line_horizontal_(), line_vertical_(), endpoint_(), inconsistent_(false)
+Field::Field() : mate_(), line_horizontal_(), line_vertical_(), endpoint_(), inconsistent_(false), trail_()
 {
 }
 Field::Field(const Problem &problem) :
-	history_(),
 	mate_(problem.height(), problem.width(), 0),
 	line_horizontal_(problem.height(), problem.width(), kEdgeUndecided),
 	line_vertical_(problem.height(), problem.width(), kEdgeUndecided),
 	endpoint_(problem.height(), problem.width(), false),
-	inconsistent_(false)
+	inconsistent_(false),
+	trail_()
 {
 	for (Y y(0); y < height(); ++y) {
 		for (X x(0); x < width(); ++x) {
@@ -203,27 +203,22 @@ void Field::SetVerticalBlank(CellPosition cell)
 }
 void Field::Restore()
 {
-	while (!history_.empty()) {
-		auto data = history_.back();
-		history_.pop_back();
+	if (!trail_.IsActive()) return;
 
-		if (data.first == 4) break;
-
-		switch (data.first & 7) {
-		case 0:
-			mate_.at(data.first >> 3) = data.second;
-			break;
-		case 1:
-			line_horizontal_.at(data.first >> 3) = static_cast<EdgeState>(data.second);
+	inconsistent_ = trail_.Rollback([this](int entry, int value) {
+		int idx = entry / kNumberOfArrays;
+		switch (entry % kNumberOfArrays) {
+		case kArrayMate:
+			mate_.at(idx) = value;
 			break;
-		case 2:
-			line_vertical_.at(data.first >> 3) = static_cast<EdgeState>(data.second);
+		case kArrayLineHorizontal:
+			line_horizontal_.at(idx) = static_cast<EdgeState>(value);
 			break;
-		case 3:
-			inconsistent_ = (data.second != 0 ? true : false);
+		case kArrayLineVertical:
+			line_vertical_.at(idx) = static_cast<EdgeState>(value);
 			break;
 		}
-	}
+	});
 }
 void Field::Inspect(CellPosition cell)
 {
@@ -2,28 +2,13 @@
 
 #include "../common/type.h"
 #include "../common/grid.h"
+#include "../common/trail.h"
 #include "nl_type.h"
 #include "nl_problem.h"
 
 #include <vector>
 #include <algorithm>
 
-template <typename T>
-class vector2
-{
-public:
-	vector2() : index(0) {}
-
-	bool empty() const { return index == 0; }
-	void push_back(const T &value) { data[index++] = value; }
-	void pop_back() { --index; }
-	T back() const { return data[index - 1]; }
-
-private:
-	T data[10000];
-	int index;
-};
-
 namespace penciloid
 {
 namespace numberlink
@@ -68,25 +53,31 @@ public:
 	void SetVerticalLine(CellPosition cell);
 	void SetVerticalBlank(CellPosition cell);
 
-	void AddRestorePoint() { history_.push_back({ 4, 0 }); }
+	// Save the current state, which is brought back by the corresponding Restore(). Restore points can be nested.
+	void AddRestorePoint() { trail_.AddCheckpoint(inconsistent_); }
 	void Restore();
 
 private:
-	void SetInconsistent() {
-		history_.push_back({ 3, (int)inconsistent_ });
-		inconsistent_ = true;
-	}
+	// The arrays changed through the trail. An entry of the trail refers to (index in the array) * kNumberOfArrays + (array).
+	enum TrailArray {
+		kArrayMate,
+		kArrayLineHorizontal,
+		kArrayLineVertical,
+		kNumberOfArrays
+	};
+
+	void SetInconsistent() { inconsistent_ = true; }
 	int GetIndex(CellPosition cell) const { return mate_.GetIndex(cell); }
 	void UpdateMate(int idx, int val) {
-		history_.push_back({ (idx << 3) | 0, mate_.at(idx) });
+		trail_.Save(idx * kNumberOfArrays + kArrayMate, mate_.at(idx));
 		mate_.at(idx) = val;
 	}
 	void UpdateLineHorizontal(int idx, EdgeState val) {
-		history_.push_back({ (idx << 3) | 1, line_horizontal_.at(idx) });
+		trail_.Save(idx * kNumberOfArrays + kArrayLineHorizontal, line_horizontal_.at(idx));
 		line_horizontal_.at(idx) = val;
 	}
 	void UpdateLineVertical(int idx, EdgeState val) {
-		history_.push_back({ (idx << 3) | 2, line_vertical_.at(idx) });
+		trail_.Save(idx * kNumberOfArrays + kArrayLineVertical, line_vertical_.at(idx));
 		line_vertical_.at(idx) = val;
 	}
 
@@ -95,11 +86,12 @@ private:
 
 	const int kFullyConnectedCell = 0x7fffffff;
 
-	vector2<std::pair<int, int> > history_;
 	Grid<int> mate_;
 	Grid<EdgeState> line_horizontal_, line_vertical_;
 	Grid<bool> endpoint_;
 	bool inconsistent_;
+	// The entries are the previous values of the arrays, and the state is <inconsistent_>
+	Trail<int, bool> trail_;
 };
 }
 }
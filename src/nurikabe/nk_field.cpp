@@ -13,10 +13,10 @@ namespace penciloid
 {
 namespace nurikabe
 {
-Field::Field() : cells_(), decided_cells_(0), inconsistent_(false), fully_solved_(false)
+Field::Field() : cells_(), decided_cells_(0), inconsistent_(false), fully_solved_(false), trail_()
 {
 }
-Field::Field(const Problem &problem) : cells_(problem.height(), problem.width(), Cell(kNoClue, kCellUndecided)), decided_cells_(0), inconsistent_(false), fully_solved_(false)
+Field::Field(const Problem &problem) : cells_(problem.height(), problem.width(), Cell(kNoClue, kCellUndecided)), decided_cells_(0), inconsistent_(false), fully_solved_(false), trail_()
 {
 	for (Y y(0); y < height(); ++y) {
 		for (X x(0); x < width(); ++x) {
@@ -37,10 +37,10 @@ Field::Field(const Problem &problem) : cells_(problem.height(), problem.width(),
 		}
 	}
 }
-Field::Field(const Field &other) : cells_(other.cells_), inconsistent_(other.inconsistent_), decided_cells_(other.decided_cells_), fully_solved_(other.fully_solved_)
+Field::Field(const Field &other) : cells_(other.cells_), inconsistent_(other.inconsistent_), decided_cells_(other.decided_cells_), fully_solved_(other.fully_solved_), trail_(other.trail_)
 {
 }
-Field::Field(Field &&other) : cells_(std::move(other.cells_)), decided_cells_(other.decided_cells_), inconsistent_(other.inconsistent_), fully_solved_(other.fully_solved_)
+Field::Field(Field &&other) : cells_(std::move(other.cells_)), decided_cells_(other.decided_cells_), inconsistent_(other.inconsistent_), fully_solved_(other.fully_solved_), trail_(std::move(other.trail_))
 {
 }
 Field::~Field()
@@ -52,6 +52,7 @@ Field &Field::operator=(const Field &other)
 	decided_cells_ = other.decided_cells_;
 	inconsistent_ = other.inconsistent_;
 	fully_solved_ = other.fully_solved_;
+	trail_ = other.trail_;
 	return *this;
 }
 Field &Field::operator=(Field &&other)
@@ -60,11 +61,12 @@ Field &Field::operator=(Field &&other)
 	decided_cells_ = other.decided_cells_;
 	inconsistent_ = other.inconsistent_;
 	fully_solved_ = other.fully_solved_;
+	trail_ = std::move(other.trail_);
 	return *this;
 }
 void Field::DecideCell(CellPosition pos, CellState status)
 {
-	Cell &cell = cells_(pos);
+	const Cell &cell = cells_(pos);
 	if (cell.status != kCellUndecided) {
 		if (cell.status != status) {
 			SetInconsistent();
@@ -76,7 +78,7 @@ void Field::DecideCell(CellPosition pos, CellState status)
 		fully_solved_ = true;
 	}
 
-	cell.status = status;
+	MutableCell(GetIndex(pos)).status = status;
 	for (Direction d : k4Neighborhood) {
 		CellPosition pos2 = pos + d;
 		if (cells_.IsPositionOnGrid(pos2) && cells_(pos2).status == status) {
@@ -128,18 +130,26 @@ void Field::Assume()
 				CellPosition pos(y, x);
 				if (GetCell(pos) != kCellUndecided) continue;
 
-				Field assume_black = *this, assume_white = *this;
-				assume_black.DecideCell(pos, kCellBlack);
-				assume_black.Solve();
-				if (assume_black.IsInconsistent()) {
+				AddRestorePoint();
+				DecideCell(pos, kCellBlack);
+				Solve();
+				bool black_inconsistent = IsInconsistent();
+				Rollback();
+				if (black_inconsistent) {
 					DecideCell(pos, kCellWhite);
 					progress = true;
 					continue;
 				}
-				assume_white.DecideCell(pos, kCellWhite);
-				assume_white.Solve();
-				if (assume_white.IsInconsistent()) {
-					*this = assume_black;
+
+				AddRestorePoint();
+				DecideCell(pos, kCellWhite);
+				Solve();
+				bool white_inconsistent = IsInconsistent();
+				Rollback();
+				if (white_inconsistent) {
+					// Redo the assumption of black, which is cheaper than keeping a copy of the field for it
+					DecideCell(pos, kCellBlack);
+					Solve();
 					progress = true;
 					continue;
 				}
@@ -148,6 +158,21 @@ void Field::Assume()
 		if (!progress || IsInconsistent() || IsFullySolved()) break;
 	}
 }
+void Field::AddRestorePoint()
+{
+	trail_.AddCheckpoint({ decided_cells_, inconsistent_, fully_solved_ });
+}
+void Field::Rollback()
+{
+	State state = trail_.Rollback([this](int cell_idx, const Cell &cell) { cells_.at(cell_idx) = cell; });
+	decided_cells_ = state.decided_cells;
+	inconsistent_ = state.inconsistent;
+	fully_solved_ = state.fully_solved;
+}
+void Field::DiscardRestorePoint()
+{
+	trail_.DiscardCheckpoint();
+}
 void Field::RestrictClueOfClosedGroups()
 {
 	for (Y y(0); y < height(); ++y) {
@@ -170,15 +195,18 @@ void Field::RestrictClueOfClosedGroups()
 
 			if (is_closed) {
 				int size = GetGroupSize(p_init);
-				cells_(pos).clue = Clue(size, size);
+				MutableCell(GetIndex(pos)).clue = Clue(size, size);
 			}
 		}
 	}
 }
 int Field::GetRoot(int cell_idx)
 {
-	if (cells_.at(cell_idx).group_parent_cell < 0) return cell_idx;
-	return cells_.at(cell_idx).group_parent_cell = GetRoot(cells_.at(cell_idx).group_parent_cell);
+	int parent = cells_.at(cell_idx).group_parent_cell;
+	if (parent < 0) return cell_idx;
+	int root = GetRoot(parent);
+	if (root != parent) MutableCell(cell_idx).group_parent_cell = root;
+	return root;
 }
 void Field::Join(int cell_idx1, int cell_idx2)
 {
@@ -187,8 +215,8 @@ void Field::Join(int cell_idx1, int cell_idx2)
 
 	if (cell_idx1 == cell_idx2) return;
 
-	auto &cell1 = cells_.at(cell_idx1);
-	auto &cell2 = cells_.at(cell_idx2);
+	auto &cell1 = MutableCell(cell_idx1);
+	auto &cell2 = MutableCell(cell_idx2);
 
 	if (cell1.clue != kNoClue && cell2.clue != kNoClue) {
 		SetInconsistent();
@@ -4,6 +4,7 @@
 #include "nk_problem.h"
 #include "../common/type.h"
 #include "../common/grid.h"
+#include "../common/trail.h"
 
 #include <iostream>
 
@@ -48,6 +49,15 @@ public:
 	void Solve();
 	void Assume();
 
+	// Add a restore point. Restore points can be nested.
+	void AddRestorePoint();
+
+	// Roll back this field to the last restore point
+	void Rollback();
+
+	// Remove the last restore point without rolling back.
+	void DiscardRestorePoint();
+
 	void CheckConsistency();
 	void ExpandBlack();
 	void ExpandWhite();
@@ -72,7 +82,19 @@ private:
 		int group_next_cell;
 	};
 
+	// The values saved at each restore point, other than the cells
+	struct State
+	{
+		CellCount decided_cells;
+		bool inconsistent, fully_solved;
+	};
+
 	int GetIndex(CellPosition pos) { return cells_.GetIndex(pos); }
+	// Returns the cell for modification, saving its current value for Rollback()
+	Cell &MutableCell(int cell_idx) {
+		trail_.Save(cell_idx, cells_.at(cell_idx));
+		return cells_.at(cell_idx);
+	}
 	int GetRoot(int cell_idx);
 	int GetGroupSize(int cell_idx) { return -cells_.at(GetRoot(cell_idx)).group_parent_cell; }
 	bool HasClueInGroup(int cell_idx) { return cells_.at(GetRoot(cell_idx)).clue != kNoClue; }
@@ -85,6 +107,7 @@ private:
 	Grid<Cell> cells_;
 	CellCount decided_cells_;
 	bool inconsistent_, fully_solved_;
+	Trail<Cell, State> trail_;
 };
 
 std::ostream &operator<<(std::ostream &stream, const Field &field);
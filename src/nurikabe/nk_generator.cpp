@@ -85,9 +85,6 @@ bool GenerateByLocalSearch(Y height, X width, std::mt19937 *rnd, Problem *ret)
 	Field current_field(current_problem);
 
 	for (; step < max_step; ++step) {
-		printf("%d (%f, %f)\n", step, current_energy, temperature);
-		std::cout << current_field << std::endl;
-		
 		Grid<bool> clue_change_candidate(height, width);
 		for (Y y(0); y < height; ++y) {
 			for (X x(0); x < width; ++x) {
@@ -0,0 +1,198 @@
+#include "sl_bitboard_field.h"
+#include "sl_field.h"
+
+namespace penciloid
+{
+namespace slitherlink
+{
+namespace
+{
+typedef unsigned long long Word;
+
+// eq[k] bit i is set if and only if exactly k of the bit i of <a>, <b>, <c> and <d> are set.
+inline void CountBits(Word a, Word b, Word c, Word d, Word (&eq)[5])
+{
+	// Bit-sliced addition: (s2 s1 s0) = a + b + c + d. At most 2 of the carries are set at once.
+	Word s = a ^ b, c1 = a & b;
+	Word t = s ^ c, c2 = s & c;
+	Word s0 = t ^ d, c3 = t & d;
+	Word s1 = c1 ^ c2 ^ c3, s2 = (c1 | c2) & c3;
+	eq[0] = ~s0 & ~s1 & ~s2;
+	eq[1] = s0 & ~s1;
+	eq[2] = ~s0 & s1;
+	eq[3] = s0 & s1;
+	eq[4] = s2;
+}
+inline int PopCount(Word w)
+{
+	int ret = 0;
+	for (; w; w &= w - 1) ++ret;
+	return ret;
+}
+}
+BitboardField::BitboardField(const Problem &problem) :
+	height_(static_cast<int>(problem.height())), width_(static_cast<int>(problem.width())),
+	h_line_(height_ + 1, 0), h_blank_(height_ + 1, 0), v_line_(height_, 0), v_blank_(height_, 0), inconsistent_(false)
+{
+	for (int c = 0; c < 4; ++c) clue_[c].assign(height_, 0);
+	for (Y y(0); y < problem.height(); ++y) {
+		for (X x(0); x < problem.width(); ++x) {
+			Clue c = problem.GetClue(CellPosition(y, x));
+			if (c != kNoClue) clue_[static_cast<int>(c)][static_cast<int>(y)] |= Word(1) << static_cast<int>(x);
+		}
+	}
+}
+void BitboardField::Propagate()
+{
+	for (;;) {
+		bool updated = PropagateCells();
+		if (PropagateVertices()) updated = true;
+		if (inconsistent_ || !updated) break;
+	}
+}
+bool BitboardField::PropagateVertices()
+{
+	const Word edge_mask = ~Word(0) >> (kWordBits - width_);
+	const Word vertex_mask = ~Word(0) >> (kWordBits - 1 - width_);
+	bool updated = false;
+
+	for (int y = 0; y <= height_; ++y) {
+		// The edges out of the field are regarded as blank
+		Word right_line = h_line_[y], right_blank = (h_blank_[y] | ~edge_mask) & vertex_mask;
+		Word left_line = h_line_[y] << 1, left_blank = ((h_blank_[y] << 1) | 1) & vertex_mask;
+		Word up_line = y > 0 ? v_line_[y - 1] : 0, up_blank = y > 0 ? v_blank_[y - 1] : vertex_mask;
+		Word down_line = y < height_ ? v_line_[y] : 0, down_blank = y < height_ ? v_blank_[y] : vertex_mask;
+		Word right_undecided = vertex_mask & ~(right_line | right_blank);
+		Word left_undecided = vertex_mask & ~(left_line | left_blank);
+		Word up_undecided = vertex_mask & ~(up_line | up_blank);
+		Word down_undecided = vertex_mask & ~(down_line | down_blank);
+
+		Word n_lines[5], n_undecided[5];
+		CountBits(right_line, left_line, up_line, down_line, n_lines);
+		CountBits(right_undecided, left_undecided, up_undecided, down_undecided, n_undecided);
+
+		if (((n_lines[3] | n_lines[4] | (n_lines[1] & n_undecided[0])) & vertex_mask) != 0) {
+			inconsistent_ = true;
+			return true;
+		}
+		Word to_line = n_lines[1] & n_undecided[1];
+		Word to_blank = n_lines[2] | (n_lines[0] & n_undecided[1]);
+
+		Word new_h_line = (to_line & right_undecided & edge_mask) | ((to_line & left_undecided) >> 1);
+		Word new_h_blank = (to_blank & right_undecided & edge_mask) | ((to_blank & left_undecided) >> 1);
+		if (new_h_line | new_h_blank) {
+			h_line_[y] |= new_h_line;
+			h_blank_[y] |= new_h_blank;
+			updated = true;
+		}
+		if (y > 0 && ((to_line | to_blank) & up_undecided)) {
+			v_line_[y - 1] |= to_line & up_undecided;
+			v_blank_[y - 1] |= to_blank & up_undecided;
+			updated = true;
+		}
+		if (y < height_ && ((to_line | to_blank) & down_undecided)) {
+			v_line_[y] |= to_line & down_undecided;
+			v_blank_[y] |= to_blank & down_undecided;
+			updated = true;
+		}
+	}
+
+	// An edge may be decided differently by its two ends
+	for (int y = 0; y <= height_; ++y) {
+		if (h_line_[y] & h_blank_[y]) inconsistent_ = true;
+		if (y < height_ && (v_line_[y] & v_blank_[y])) inconsistent_ = true;
+	}
+	return updated;
+}
+bool BitboardField::PropagateCells()
+{
+	const Word cell_mask = ~Word(0) >> (kWordBits - width_);
+	bool updated = false;
+
+	for (int y = 0; y < height_; ++y) {
+		Word has_clue = clue_[0][y] | clue_[1][y] | clue_[2][y] | clue_[3][y];
+		if (has_clue == 0) continue;
+
+		Word top_line = h_line_[y], top_blank = h_blank_[y];
+		Word bottom_line = h_line_[y + 1], bottom_blank = h_blank_[y + 1];
+		Word left_line = v_line_[y] & cell_mask, left_blank = v_blank_[y] & cell_mask;
+		Word right_line = (v_line_[y] >> 1) & cell_mask, right_blank = (v_blank_[y] >> 1) & cell_mask;
+
+		Word n_lines[5], n_non_blanks[5];
+		CountBits(top_line, bottom_line, left_line, right_line, n_lines);
+		CountBits(~top_blank, ~bottom_blank, ~left_blank, ~right_blank, n_non_blanks);
+
+		// The undecided edges around a clue are blank if the lines are enough, and lines if the non-blank edges are just enough
+		Word to_blank = 0, to_line = 0, consistent = 0;
+		Word lines_at_most = 0, non_blanks_at_least = has_clue;
+		for (int c = 0; c < 4; ++c) {
+			lines_at_most |= n_lines[c];
+			to_blank |= clue_[c][y] & n_lines[c];
+			to_line |= clue_[c][y] & n_non_blanks[c];
+			consistent |= clue_[c][y] & lines_at_most & non_blanks_at_least;
+			non_blanks_at_least &= ~n_non_blanks[c];
+		}
+		if (has_clue & ~consistent) {
+			inconsistent_ = true;
+			return true;
+		}
+
+		Word top_undecided = ~(top_line | top_blank), bottom_undecided = ~(bottom_line | bottom_blank);
+		Word left_undecided = ~(left_line | left_blank), right_undecided = ~(right_line | right_blank);
+		Word decided = to_line | to_blank;
+		if (decided & (top_undecided | bottom_undecided | left_undecided | right_undecided) & cell_mask) {
+			h_line_[y] |= to_line & top_undecided;
+			h_blank_[y] |= to_blank & top_undecided;
+			h_line_[y + 1] |= to_line & bottom_undecided;
+			h_blank_[y + 1] |= to_blank & bottom_undecided;
+			v_line_[y] |= (to_line & left_undecided) | ((to_line & right_undecided) << 1);
+			v_blank_[y] |= (to_blank & left_undecided) | ((to_blank & right_undecided) << 1);
+			updated = true;
+		}
+	}
+	return updated;
+}
+int BitboardField::GetNumberOfDecidedEdges() const
+{
+	int ret = 0;
+	for (int y = 0; y <= height_; ++y) {
+		ret += PopCount(h_line_[y] | h_blank_[y]);
+		if (y < height_) ret += PopCount(v_line_[y] | v_blank_[y]);
+	}
+	return ret;
+}
+bool BitboardField::IsLine(LoopPosition edge) const
+{
+	int y = static_cast<int>(edge.y), x = static_cast<int>(edge.x);
+	if (y % 2 == 0) return ((h_line_[y / 2] >> (x / 2)) & 1) != 0;
+	return ((v_line_[y / 2] >> (x / 2)) & 1) != 0;
+}
+bool BitboardField::IsBlank(LoopPosition edge) const
+{
+	int y = static_cast<int>(edge.y), x = static_cast<int>(edge.x);
+	if (y % 2 == 0) return ((h_blank_[y / 2] >> (x / 2)) & 1) != 0;
+	return ((v_blank_[y / 2] >> (x / 2)) & 1) != 0;
+}
+void BitboardField::ApplyTo(Field *field) const
+{
+	if (inconsistent_) {
+		field->SetInconsistent();
+		return;
+	}
+	// The lines are decided first: GridLoop eliminates a closed chain of undecided edges
+	// only if some line exists when the chain is closed (by blanks).
+	field->QueuedRun([this, field]() {
+		for (int pass = 0; pass < 2; ++pass) {
+			for (Y y(0); y <= 2 * height_; ++y) {
+				for (X x(0); x <= 2 * width_; ++x) {
+					if (static_cast<int>(y % 2) == static_cast<int>(x % 2)) continue;
+					LoopPosition edge(y, x);
+					if (pass == 0 && IsLine(edge)) field->DecideEdge(edge, Field::kEdgeLine);
+					if (pass == 1 && IsBlank(edge)) field->DecideEdge(edge, Field::kEdgeBlank);
+				}
+			}
+		}
+	});
+}
+}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "../common/type.h"
+#include "sl_type.h"
+#include "sl_problem.h"
+
+namespace penciloid
+{
+namespace slitherlink
+{
+class Field;
+
+// A field which keeps the status of the edges as bitboards (a word per row of horizontal / vertical edges),
+// so that the local rules (the degree of each vertex and the number of lines around each clue) are applied
+// to a whole row by a few word operations. Rules on the topology of the loop are not handled here;
+// ApplyTo passes the result to Field, which continues the propagation with all its rules.
+class BitboardField
+{
+public:
+	// The vertices of a row must fit in a word
+	static const int kMaxWidth = 63;
+
+	static bool IsSupported(Y height, X width) { return 0 < height && 0 < width && width <= kMaxWidth; }
+
+	// <problem> must satisfy IsSupported.
+	BitboardField(const Problem &problem);
+
+	// Applies the local rules until nothing changes.
+	void Propagate();
+
+	bool IsInconsistent() const { return inconsistent_; }
+	int GetNumberOfDecidedEdges() const;
+
+	// <edge> should be a legitimate position.
+	bool IsLine(LoopPosition edge) const;
+	bool IsBlank(LoopPosition edge) const;
+
+	// Decides the edges decided in this field in <field>, which should have the same size.
+	// Field may end up with fewer deductions than when built from the clues only, since GridLoop eliminates
+	// a closed chain of undecided edges only if some line is already decided at that time.
+	void ApplyTo(Field *field) const;
+
+private:
+	typedef unsigned long long Word;
+	// Masks are built by shifting ~Word(0) right, since shifting a word by its width is undefined
+	static const int kWordBits = 64;
+
+	bool PropagateVertices();
+	bool PropagateCells();
+
+	int height_, width_;
+	// h_*_[y] bit x: the edge between the vertices (y, x) and (y, x + 1) (0 <= y <= height_)
+	// v_*_[y] bit x: the edge between the vertices (y, x) and (y + 1, x) (0 <= y < height_)
+	std::vector<Word> h_line_, h_blank_, v_line_, v_blank_;
+	// clue_[c][y] bit x: whether the clue of the cell (y, x) is c
+	std::vector<Word> clue_[4];
+	bool inconsistent_;
+};
+}
+}
\ No newline at end of file
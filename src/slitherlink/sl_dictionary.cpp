@@ -1,5 +1,21 @@
 #include "sl_dictionary.h"
 #include "../common/grid.h"
+#include "../common/thread_pool.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 namespace penciloid
 {
@@ -24,20 +40,47 @@ const Direction Dictionary::kNeighbor[12] = {
 	Direction(Y(2), X(1)),
 };
 
-Dictionary::Dictionary() : data_(nullptr)
+const Direction Dictionary::kPairNeighbor[9] = {
+	Direction(Y(-1), X(0)),  // top of the left cell
+	Direction(Y(-1), X(2)),  // top of the right cell
+	Direction(Y(0), X(-1)),  // left
+	Direction(Y(0), X(1)),   // between the cells
+	Direction(Y(0), X(3)),   // right
+	Direction(Y(1), X(0)),   // bottom of the left cell
+	Direction(Y(1), X(2)),   // bottom of the right cell
+	Direction(Y(-2), X(1)),  // above the upper vertex between the cells
+	Direction(Y(2), X(1)),   // below the lower vertex between the cells
+};
+
+const unsigned int Dictionary::kTernaryOfBits[64] = {
+	0, 1, 3, 4, 9, 10, 12, 13, 27, 28, 30, 31, 36, 37, 39, 40,
+	81, 82, 84, 85, 90, 91, 93, 94, 108, 109, 111, 112, 117, 118, 120, 121,
+	243, 244, 246, 247, 252, 253, 255, 256, 270, 271, 273, 274, 279, 280, 282, 283,
+	324, 325, 327, 328, 333, 334, 336, 337, 351, 352, 354, 355, 360, 361, 363, 364
+};
+const char Dictionary::kFileMagic[8] = { 'P', 'N', 'C', 'L', 'S', 'L', 'D', '2' };
+// Definitions for the cases where they are bound to references (e.g. std::min)
+const int Dictionary::kDatabaseSizeForEachClue;
+const int Dictionary::kDatabaseSize;
+const int Dictionary::kPairDatabaseSizeForEachClue;
+
+Dictionary::Dictionary() : results_(nullptr), entries_(nullptr), n_results_(0), method_key_(0), mapped_(nullptr), mapped_size_(0)
 {
 }
 Dictionary::~Dictionary()
 {
 	Release();
 }
-void Dictionary::CreateDefault()
+bool Dictionary::CreateDefault(int n_threads)
 {
 	Release();
 
-	data_ = new unsigned int[kDatabaseSize];
+	std::vector<unsigned int> data(kDatabaseSize);
+	method_key_ = MethodKey(DictionaryMethod());
 
-	for (int clue = 0; clue < 4; ++clue) {
+	// The tables of the clues are independent of each other
+	ThreadPool pool(std::min(n_threads, 4));
+	pool.ParallelFor(4, [&](int worker, int clue) {
 		unsigned int offset = clue * kDatabaseSizeForEachClue;
 		for (unsigned int id = kDatabaseSizeForEachClue; id--;){
 			int pattern[12];
@@ -58,89 +101,144 @@ void Dictionary::CreateDefault()
 				if (CountLines(pattern, 3, 5, 6, 8) != clue) is_valid = false;
 
 				if (is_valid) {
-					data_[offset + id] = 0;
+					data[offset + id] = 0;
 					for (int i = 0; i < 12; ++i) {
-						data_[offset + id] |= pattern[i] << (2 * i);
+						data[offset + id] |= pattern[i] << (2 * i);
 					}
-				} else data_[offset + id] = 0xffffffffU;
+				} else data[offset + id] = 0xffffffffU;
 			} else {
 				pattern[undecided_pos] = kLine;
 				unsigned int ref_id1 = PatternToId(pattern);
 				pattern[undecided_pos] = kBlank;
 				unsigned int ref_id2 = PatternToId(pattern);
 
-				data_[offset + id] = data_[offset + ref_id1] & data_[offset + ref_id2];
+				data[offset + id] = data[offset + ref_id1] & data[offset + ref_id2];
 			}
 		}
 
 		for (unsigned int id = 0; id < kDatabaseSizeForEachClue; ++id){
-			if (data_[offset + id] == 0xffffffffU) continue;
+			if (data[offset + id] == 0xffffffffU) continue;
 
 			int pattern[12];
 
 			IdToPattern(id, &pattern);
 			for (int i = 0; i < 12; ++i) {
-				if (pattern[i] != kUndecided) data_[offset + id] &= ~(3 << (2 * i));
+				if (pattern[i] != kUndecided) data[offset + id] &= ~(3 << (2 * i));
 			}
 		}
-	}
+	});
+
+	return Compact(data);
 }
-void Dictionary::CreateRestricted(const DictionaryMethod &method)
+bool Dictionary::CreateRestricted(const DictionaryMethod &method, int n_threads)
 {
 	Release();
 
-	data_ = new unsigned int[kDatabaseSize];
+	std::vector<unsigned int> data(kDatabaseSize);
+	method_key_ = MethodKey(method);
 
-	for (int clue = 0; clue < 4; ++clue) {
-		unsigned int offset = clue * kDatabaseSizeForEachClue;
-		for (unsigned int id = 0; id < kDatabaseSizeForEachClue; ++id) {
-			int pattern[12];
-			Grid<int> field(Y(5), X(5), 0);
+	// Every pattern is independent, so the patterns are split into blocks
+	const int kPatternsPerBlock = 4096;
+	const int n_blocks = (kDatabaseSize + kPatternsPerBlock - 1) / kPatternsPerBlock;
+	ThreadPool pool(n_threads);
+	pool.ParallelFor(n_blocks, [&](int worker, int block) {
+		int end = std::min((block + 1) * kPatternsPerBlock, kDatabaseSize);
+		for (int i = block * kPatternsPerBlock; i < end; ++i) {
+			data[i] = ComputeRestricted(method, i / kDatabaseSizeForEachClue, i % kDatabaseSizeForEachClue);
+		}
+	});
+
+	return Compact(data);
+}
+void Dictionary::CreatePairTable()
+{
+	pair_data_.assign(kPairDatabaseSizeForEachClue * 16, 0);
+
+	for (int clue = 0; clue < 16; ++clue) {
+		int clue1 = clue / 4, clue2 = clue % 4;
+		unsigned int offset = clue * kPairDatabaseSizeForEachClue;
+
+		// The same as CreateDefault: a pattern with an undecided edge is the intersection of the two patterns with it decided
+		for (unsigned int id = kPairDatabaseSizeForEachClue; id--;) {
+			int pattern[9];
+			int undecided_pos = -1;
 
 			IdToPattern(id, &pattern);
-			for (int i = 0; i < 12; ++i) {
-				field(CellPosition(Y(2), X(2)) + kNeighbor[i]) = pattern[i];
+
+			for (int i = 0; i < 9; ++i) {
+				if (pattern[i] == kUndecided) undecided_pos = i;
 			}
 
-			bool inconsistent = false;
-			if (ApplyAdjacentLines(method, field, clue)) goto fail;
-			if (ApplyTwoLines(method, field, clue)) goto fail;
-			if (ApplyCornerClue(method, field, clue)) goto fail;
-			if (ApplyLineToClue(method, field, clue)) goto fail;
-			if (ApplyLineFromClue(method, field, clue)) goto fail;
-			if (ApplyPartialLineToClue(method, field, clue)) goto fail;
-			if (ApplyAdjacentLines(method, field, clue)) goto fail;
-			if (ApplyTwoLines(method, field, clue)) goto fail;
-
-			for (Y y(0); y < 5; ++y) {
-				for (X x(0); x < 5; ++x) {
-					if (static_cast<int>(y % 2) != static_cast<int>(x % 2) && field(y, x) == 3) {
-						goto fail;
+			if (undecided_pos == -1) {
+				bool is_valid = true;
+				if (!IsValidVertex(pattern, 0, 1, 3, 7)) is_valid = false;
+				if (!IsValidVertex(pattern, 3, 5, 6, 8)) is_valid = false;
+				if (static_cast<int>(CountLines(pattern, 0, 2, 3, 5)) != clue1) is_valid = false;
+				if (static_cast<int>(CountLines(pattern, 1, 3, 4, 6)) != clue2) is_valid = false;
+
+				if (is_valid) {
+					pair_data_[offset + id] = 0;
+					for (int i = 0; i < 9; ++i) {
+						pair_data_[offset + id] |= pattern[i] << (2 * i);
 					}
-				}
-			}
-			if (inconsistent) {
-				data_[offset + id] = 0xffffffffU;
-				continue;
-			}
-			for (int i = 0; i < 12; ++i) {
-				pattern[i] = field(kCenter + kNeighbor[i]);
-			}
-			data_[offset + id] = 0;
-			for (int i = 0; i < 12; ++i) {
-				data_[offset + id] |= pattern[i] << (2 * i);
+				} else pair_data_[offset + id] = 0xffffffffU;
+			} else {
+				pattern[undecided_pos] = kLine;
+				unsigned int ref_id1 = PatternToId(pattern);
+				pattern[undecided_pos] = kBlank;
+				unsigned int ref_id2 = PatternToId(pattern);
+
+				pair_data_[offset + id] = pair_data_[offset + ref_id1] & pair_data_[offset + ref_id2];
 			}
+		}
+
+		for (unsigned int id = 0; id < kPairDatabaseSizeForEachClue; ++id) {
+			if (pair_data_[offset + id] == 0xffffffffU) continue;
+
+			int pattern[9];
 
 			IdToPattern(id, &pattern);
-			for (int i = 0; i < 12; ++i) {
-				if (pattern[i] != kUndecided) data_[offset + id] &= ~(3 << (2 * i));
+			for (int i = 0; i < 9; ++i) {
+				if (pattern[i] != kUndecided) pair_data_[offset + id] &= ~(3 << (2 * i));
 			}
-			continue;
+		}
+	}
+}
+unsigned int Dictionary::ComputeRestricted(const DictionaryMethod &method, int clue, unsigned int id)
+{
+	int pattern[12];
+	Grid<int> field(Y(5), X(5), 0);
+
+	IdToPattern(id, &pattern);
+	for (int i = 0; i < 12; ++i) {
+		field(CellPosition(Y(2), X(2)) + kNeighbor[i]) = pattern[i];
+	}
 
-		fail:
-			data_[offset + id] = 0xffffffffU;
+	if (ApplyAdjacentLines(method, field, clue)) return 0xffffffffU;
+	if (ApplyTwoLines(method, field, clue)) return 0xffffffffU;
+	if (ApplyCornerClue(method, field, clue)) return 0xffffffffU;
+	if (ApplyLineToClue(method, field, clue)) return 0xffffffffU;
+	if (ApplyLineFromClue(method, field, clue)) return 0xffffffffU;
+	if (ApplyPartialLineToClue(method, field, clue)) return 0xffffffffU;
+	if (ApplyAdjacentLines(method, field, clue)) return 0xffffffffU;
+	if (ApplyTwoLines(method, field, clue)) return 0xffffffffU;
+
+	for (Y y(0); y < 5; ++y) {
+		for (X x(0); x < 5; ++x) {
+			if (static_cast<int>(y % 2) != static_cast<int>(x % 2) && field(y, x) == 3) {
+				return 0xffffffffU;
+			}
 		}
 	}
+
+	unsigned int ret = 0;
+	for (int i = 0; i < 12; ++i) {
+		ret |= field(kCenter + kNeighbor[i]) << (2 * i);
+	}
+	for (int i = 0; i < 12; ++i) {
+		if (pattern[i] != kUndecided) ret &= ~(3 << (2 * i));
+	}
+	return ret;
 }
 bool Dictionary::ApplyTwoLines(const DictionaryMethod &method, Grid<int> &field, int clue)
 {
@@ -335,22 +433,175 @@ bool Dictionary::ApplyLineFromClue(const DictionaryMethod &method, Grid<int> &fi
 }
 void Dictionary::Release()
 {
-	if (data_) delete[] data_;
+	if (mapped_) {
+#ifndef _WIN32
+		munmap(mapped_, mapped_size_);
+#endif
+		mapped_ = nullptr;
+		mapped_size_ = 0;
+	} else {
+		if (results_) delete[] results_;
+		if (entries_) delete[] entries_;
+	}
+	results_ = nullptr;
+	entries_ = nullptr;
+	n_results_ = 0;
+	pair_data_.clear();
+}
+bool Dictionary::Compact(const std::vector<unsigned int> &data)
+{
+	// Few distinct results appear (about 40000 for the default dictionary), so each entry is stored as the index of its result
+	std::unordered_map<unsigned int, unsigned int> result_index;
+	std::vector<unsigned int> results;
+	entries_ = new unsigned short[kDatabaseSize];
+	for (int i = 0; i < kDatabaseSize; ++i) {
+		auto it = result_index.find(data[i]);
+		if (it == result_index.end()) {
+			if (results.size() > 0xffff) {
+				// The index of the new result doesn't fit in unsigned short
+				delete[] entries_;
+				entries_ = nullptr;
+				return false;
+			}
+			it = result_index.insert({ data[i], static_cast<unsigned int>(results.size()) }).first;
+			results.push_back(data[i]);
+		}
+		entries_[i] = static_cast<unsigned short>(it->second);
+	}
+	n_results_ = static_cast<unsigned int>(results.size());
+	results_ = new unsigned int[n_results_];
+	std::copy(results.begin(), results.end(), results_);
+	return true;
 }
-unsigned int Dictionary::PatternToId(int (&pattern)[12])
+unsigned int Dictionary::MethodKey(const DictionaryMethod &method)
 {
+	const bool flags[] = {
+		method.two_lines,
+		method.adjacent_lines,
+		method.corner_clue_1, method.corner_clue_2, method.corner_clue_3,
+		method.corner_clue_2_hard,
+		method.line_to_clue_1, method.line_to_clue_2, method.line_to_clue_3,
+		method.partial_line_to_clue_2,
+		method.line_from_clue_1, method.line_from_clue_3
+	};
 	unsigned int ret = 0;
-	for (int i = 11; i >= 0; --i) {
-		ret = ret * 3 + pattern[i];
+	for (std::size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+		if (flags[i]) ret |= 1U << i;
 	}
 	return ret;
 }
-void Dictionary::IdToPattern(unsigned int id, int (*pattern)[12])
+bool Dictionary::Save(const std::string &filename) const
 {
-	for (int i = 0; i < 12; ++i) {
-		(*pattern)[i] = id % 3;
-		id /= 3;
+	if (!entries_) return false;
+
+	// Write to a temporary file and rename it, so that no process maps a partially written file.
+	// The temporary file is unique to this process, so that concurrent writers don't overwrite each other's one.
+#ifdef _WIN32
+	int pid = _getpid();
+#else
+	int pid = static_cast<int>(getpid());
+#endif
+	std::string tmp_filename = filename + ".tmp" + std::to_string(pid);
+	FILE *fp = fopen(tmp_filename.c_str(), "wb");
+	if (!fp) return false;
+
+	FileHeader header;
+	memcpy(header.magic, kFileMagic, sizeof(header.magic));
+	header.method_key = method_key_;
+	header.size = kDatabaseSize;
+	header.n_results = n_results_;
+	bool succeeded = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& fwrite(results_, sizeof(unsigned int), n_results_, fp) == n_results_
+		&& fwrite(entries_, sizeof(unsigned short), kDatabaseSize, fp) == kDatabaseSize;
+	if (fclose(fp) != 0) succeeded = false;
+
+	if (succeeded) {
+#ifdef _WIN32
+		// rename doesn't replace an existing file on Windows
+		std::remove(filename.c_str());
+#endif
+		// On POSIX systems, rename replaces <filename> atomically
+		succeeded = std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+	}
+	if (!succeeded) std::remove(tmp_filename.c_str());
+	return succeeded;
+}
+bool Dictionary::Load(const std::string &filename, const DictionaryMethod &method)
+{
+	Release();
+
+	FileHeader header;
+
+#ifdef _WIN32
+	FILE *fp = fopen(filename.c_str(), "rb");
+	if (!fp) return false;
+	if (fread(&header, sizeof(header), 1, fp) != 1
+		|| memcmp(header.magic, kFileMagic, sizeof(header.magic)) != 0
+		|| header.method_key != MethodKey(method) || header.size != kDatabaseSize || header.n_results > 0x10000) {
+		fclose(fp);
+		return false;
 	}
+	n_results_ = header.n_results;
+	results_ = new unsigned int[n_results_];
+	entries_ = new unsigned short[kDatabaseSize];
+	bool succeeded = fread(results_, sizeof(unsigned int), n_results_, fp) == n_results_
+		&& fread(entries_, sizeof(unsigned short), kDatabaseSize, fp) == kDatabaseSize;
+	fclose(fp);
+	if (!succeeded || !HasValidEntries()) {
+		Release();
+		return false;
+	}
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(FileHeader)) {
+		close(fd);
+		return false;
+	}
+	std::size_t file_size = static_cast<std::size_t>(st.st_size);
+	void *mapped = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) return false;
+
+	memcpy(&header, mapped, sizeof(header));
+	if (memcmp(header.magic, kFileMagic, sizeof(header.magic)) != 0
+		|| header.method_key != MethodKey(method) || header.size != kDatabaseSize || header.n_results > 0x10000
+		|| file_size != sizeof(FileHeader) + sizeof(unsigned int) * header.n_results + sizeof(unsigned short) * kDatabaseSize) {
+		munmap(mapped, file_size);
+		return false;
+	}
+	mapped_ = mapped;
+	mapped_size_ = file_size;
+	n_results_ = header.n_results;
+	// The tables are never modified after the creation, so the read-only mapping can be used as they are
+	results_ = reinterpret_cast<unsigned int*>(static_cast<char*>(mapped) + sizeof(FileHeader));
+	entries_ = reinterpret_cast<unsigned short*>(results_ + n_results_);
+	if (!HasValidEntries()) {
+		Release();
+		return false;
+	}
+#endif
+	method_key_ = header.method_key;
+	return true;
 }
+bool Dictionary::HasValidEntries() const
+{
+	for (int i = 0; i < kDatabaseSize; ++i) {
+		if (entries_[i] >= n_results_) return false;
+	}
+	return true;
+}
+bool Dictionary::LoadOrCreate(const std::string &filename, const DictionaryMethod &method, int n_threads)
+{
+	if (Load(filename, method)) return true;
+
+	bool created;
+	if (MethodKey(method) == MethodKey(DictionaryMethod())) created = CreateDefault(n_threads);
+	else created = CreateRestricted(method, n_threads);
+	if (!created) return false;
+	Save(filename);
+	return true;
 }
 }
+}
\ No newline at end of file
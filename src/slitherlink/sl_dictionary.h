@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "../common/type.h"
 #include "../common/grid.h"
 #include "sl_dictionary_method.h"
@@ -15,6 +18,7 @@ public:
 	static const unsigned int kLine = 1;
 	static const unsigned int kBlank = 2;
 	static const Direction kNeighbor[12];
+	static const Direction kPairNeighbor[9];
 
 	Dictionary();
 
@@ -25,35 +29,106 @@ public:
 
 	~Dictionary();
 	
-	void CreateDefault();
-	void CreateRestricted(const DictionaryMethod &method);
+	// The tables are built by <n_threads> threads (CreateDefault uses at most 4, one per clue).
+	// Returns false (and the dictionary is left released) if the tables have more distinct results than
+	// the 2-byte entries can index (see entries_).
+	bool CreateDefault(int n_threads = 1);
+	bool CreateRestricted(const DictionaryMethod &method, int n_threads = 1);
 	void Release();
 
+	// Writes the dictionary to <filename>. Returns true if and only if succeeded.
+	bool Save(const std::string &filename) const;
+	// Maps the dictionary saved in <filename>, which must be created with <method>, into the memory.
+	// The mapping is read-only and shared, so processes loading the same file share one physical copy.
+	// Returns false (and the dictionary is left released) if the file is missing, doesn't match <method> or is corrupt.
+	bool Load(const std::string &filename, const DictionaryMethod &method);
+	// Loads <filename> if possible. Otherwise, creates the dictionary with <method> and tries to save it to <filename>.
+	// Returns false if neither the loading nor the creation succeeded.
+	bool LoadOrCreate(const std::string &filename, const DictionaryMethod &method, int n_threads = 1);
+
 	// clue: 0, 1, 2 or 3
 	// edge_pattern: \sum_{i=0}^11 ev[i] * (3^i)
 	// where ev[i] = (kUndecided if the edge at (cell + kNeighbor[i]) is undecided, ...)
 	// returns \sum_{i=0}^11 ev'[i] * (4^i) or 0xffffffff (if inconsistent)
 	inline unsigned int Get(unsigned int edge_pattern, unsigned int clue) {
-		return data_[edge_pattern + clue * kDatabaseSizeForEachClue];
+		return results_[entries_[edge_pattern + clue * kDatabaseSizeForEachClue]];
+	}
+
+	// Creates the optional table for pairs of horizontally adjacent clues, which is not saved to the files.
+	// It covers the 7 edges around the pair and the 2 edges sticking out of the vertices between the cells
+	// (kPairNeighbor[i], relative to the left cell). Vertical pairs use it by swapping y and x.
+	void CreatePairTable();
+	bool HasPairTable() const { return !pair_data_.empty(); }
+
+	// The same as Get, but for the pair table and edge_pattern of the 9 edges of kPairNeighbor.
+	// clue1 is of the left (or upper) cell.
+	inline unsigned int GetPair(unsigned int edge_pattern, unsigned int clue1, unsigned int clue2) {
+		return pair_data_[edge_pattern + (clue1 * 4 + clue2) * kPairDatabaseSizeForEachClue];
+	}
+
+	// Computes edge_pattern for Get from the masks of the lines and the blanks
+	// (bit i of <line_mask> is set if and only if the edge at (cell + kNeighbor[i]) is kLine).
+	static inline unsigned int PatternId(unsigned int line_mask, unsigned int blank_mask) {
+		return kTernaryOfBits[line_mask & 63] + 729 * kTernaryOfBits[line_mask >> 6]
+			+ 2 * (kTernaryOfBits[blank_mask & 63] + 729 * kTernaryOfBits[blank_mask >> 6]);
 	}
 
 private:
 	// 531441 = 3^12
 	static const int kDatabaseSizeForEachClue = 531441;
 	static const int kDatabaseSize = kDatabaseSizeForEachClue * 4;
+	// 19683 = 3^9
+	static const int kPairDatabaseSizeForEachClue = 19683;
+
+	// Header of the dictionary files. The entries follow it in the native byte order.
+	struct FileHeader
+	{
+		char magic[8];
+		unsigned int method_key;
+		unsigned int size;
+		unsigned int n_results;
+	};
+	static const char kFileMagic[8];
 
-	unsigned int PatternToId(int (&pattern)[12]);
-	void IdToPattern(unsigned int id, int (*pattern)[12]);
-	inline unsigned int CountLines(int (&pattern)[12], int p1, int p2, int p3, int p4) {
+	// kTernaryOfBits[m] = \sum_{i: bit i of m is set} 3^i
+	static const unsigned int kTernaryOfBits[64];
+
+	static unsigned int MethodKey(const DictionaryMethod &method);
+
+	// Sets <entries_> and <results_> from the uncompressed table <data>.
+	// Returns false (leaving them released) if <data> has more than 65536 distinct results.
+	bool Compact(const std::vector<unsigned int> &data);
+	// Checks that every entry indexes <results_>, so that a corrupt file isn't read out of bounds.
+	bool HasValidEntries() const;
+
+	template <int N>
+	unsigned int PatternToId(int (&pattern)[N]) {
+		unsigned int ret = 0;
+		for (int i = N - 1; i >= 0; --i) {
+			ret = ret * 3 + pattern[i];
+		}
+		return ret;
+	}
+	template <int N>
+	void IdToPattern(unsigned int id, int (*pattern)[N]) {
+		for (int i = 0; i < N; ++i) {
+			(*pattern)[i] = id % 3;
+			id /= 3;
+		}
+	}
+	inline unsigned int CountLines(const int *pattern, int p1, int p2, int p3, int p4) {
 		return
 			  (pattern[p1] == kLine ? 1 : 0) + (pattern[p2] == kLine ? 1 : 0)
 			+ (pattern[p3] == kLine ? 1 : 0) + (pattern[p4] == kLine ? 1 : 0);
 	}
-	inline bool IsValidVertex(int (&pattern)[12], int p1, int p2, int p3, int p4) {
+	inline bool IsValidVertex(const int *pattern, int p1, int p2, int p3, int p4) {
 		int count = CountLines(pattern, p1, p2, p3, p4);
 		return count == 0 || count == 2;
 	}
 
+	// Returns the entry of the restricted dictionary for (<clue>, <id>).
+	unsigned int ComputeRestricted(const DictionaryMethod &method, int clue, unsigned int id);
+
 	// Apply methods to <field>.
 	// Returns true if and only if inconsistency is detected.
 	bool ApplyTwoLines(const DictionaryMethod &method, Grid<int> &field, int clue);
@@ -63,7 +138,18 @@ private:
 	bool ApplyPartialLineToClue(const DictionaryMethod &method, Grid<int> &field, int clue);
 	bool ApplyLineFromClue(const DictionaryMethod &method, Grid<int> &field, int clue);
 
-	unsigned int *data_;
+	// The result of pattern id is results_[entries_[id]].
+	// Only ~40000 distinct results exist, so entries_ takes 2 bytes per pattern instead of 4.
+	unsigned int *results_;
+	unsigned short *entries_;
+	unsigned int n_results_;
+	unsigned int method_key_;
+
+	std::vector<unsigned int> pair_data_;
+
+	// Pointer and size of the mapped file, or nullptr if <results_> and <entries_> are allocated by new[]
+	void *mapped_;
+	std::size_t mapped_size_;
 };
 }
 }
@@ -6,24 +6,36 @@
 
 #include "sl_problem.h"
 #include "sl_dictionary.h"
+#include "../common/util.h"
 
 namespace penciloid
 {
 namespace slitherlink
 {
-Field::Field() : GridLoop<Field>(), field_clue_(), database_(nullptr), method_()
+namespace
+{
+unsigned long long ClueKey(int id, Clue clue)
+{
+	if (clue == kNoClue) return 0;
+	return MixBits(static_cast<unsigned long long>(id) * 4 + static_cast<int>(clue));
+}
+}
+const int Field::kTrialMarker;
+const int Field::kFrameMarker;
+
+Field::Field() : GridLoop<Field>(), field_clue_(), database_(nullptr), method_(), clue_history_(), trial_depth_(0), max_clue_frames_(0), clue_hash_(0)
 {
 }
 Field::Field(Y height, X width, Dictionary *database, const Method &met) :
-	GridLoop<Field>(height, width), field_clue_(height, width, kNoClue), database_(database), method_(met)
+	GridLoop<Field>(height, width), field_clue_(height, width, kNoClue), database_(database), method_(met), clue_history_(), trial_depth_(0), max_clue_frames_(0), clue_hash_(0)
 {
 	GridLoop<Field>::SetMethod(met.grid_loop_method);
 }
-Field::Field(const Field& other) : GridLoop<Field>(other), field_clue_(other.field_clue_), database_(other.database_), method_(other.method_)
+Field::Field(const Field& other) : GridLoop<Field>(other), field_clue_(other.field_clue_), database_(other.database_), method_(other.method_), clue_history_(other.clue_history_), trial_depth_(other.trial_depth_), max_clue_frames_(other.max_clue_frames_), clue_hash_(other.clue_hash_)
 {
 	GridLoop<Field>::SetMethod(other.method_.grid_loop_method);
 }
-Field::Field(Field&& other) : GridLoop<Field>(other), field_clue_(std::move(other.field_clue_)), database_(other.database_), method_(other.method_)
+Field::Field(Field&& other) : GridLoop<Field>(other), field_clue_(std::move(other.field_clue_)), database_(other.database_), method_(other.method_), clue_history_(std::move(other.clue_history_)), trial_depth_(other.trial_depth_), max_clue_frames_(other.max_clue_frames_), clue_hash_(other.clue_hash_)
 {
 	GridLoop<Field>::SetMethod(other.method_.grid_loop_method);
 }
@@ -34,6 +46,10 @@ Field &Field::operator=(const Field& other)
 	field_clue_ = other.field_clue_;
 	database_ = other.database_;
 	method_ = other.method_;
+	clue_history_ = other.clue_history_;
+	trial_depth_ = other.trial_depth_;
+	max_clue_frames_ = other.max_clue_frames_;
+	clue_hash_ = other.clue_hash_;
 
 	return *this;
 }
@@ -44,11 +60,15 @@ Field &Field::operator=(Field&& other)
 	field_clue_ = std::move(other.field_clue_);
 	database_ = other.database_;
 	method_ = other.method_;
+	clue_history_ = std::move(other.clue_history_);
+	trial_depth_ = other.trial_depth_;
+	max_clue_frames_ = other.max_clue_frames_;
+	clue_hash_ = other.clue_hash_;
 
 	return *this;
 }
 Field::Field(const Problem& problem, Dictionary *database, const Method &met) :
-	GridLoop<Field>(problem.height(), problem.width()), field_clue_(problem.height(), problem.width(), kNoClue), database_(database), method_(met)
+	GridLoop<Field>(problem.height(), problem.width()), field_clue_(problem.height(), problem.width(), kNoClue), database_(database), method_(met), clue_history_(), trial_depth_(0), max_clue_frames_(0), clue_hash_(0)
 {
 	GridLoop<Field>::SetMethod(met.grid_loop_method);
 	int cell_count = static_cast<int>(height()) * static_cast<int>(width());
@@ -65,6 +85,16 @@ Field::~Field()
 {
 }
 void Field::AddClue(CellPosition pos, Clue clue)
+{
+	if (max_clue_frames_ > 0 && trial_depth_ == 0) {
+		BeginTrial();
+		AddClueInternal(pos, clue);
+		CommitTrial();
+	} else {
+		AddClueInternal(pos, clue);
+	}
+}
+void Field::AddClueInternal(CellPosition pos, Clue clue)
 {
 	if (GetClue(pos) != kNoClue) {
 		if (GetClue(pos) != clue) {
@@ -73,33 +103,196 @@ void Field::AddClue(CellPosition pos, Clue clue)
 		return;
 	}
 
-	field_clue_(pos) = clue;
+	if (!clue_history_.empty()) clue_history_.push_back({ static_cast<int>(CellId(pos)), field_clue_(pos) });
+	SetClueById(static_cast<int>(CellId(pos)), clue);
 	ApplyTheorem(LoopPosition(pos.y * 2 + 1, pos.x * 2 + 1));
 	Check(LoopPosition(pos.y * 2 + 1, pos.x * 2 + 1));
 }
+void Field::SetClueById(int id, Clue clue)
+{
+	clue_hash_ ^= ClueKey(id, field_clue_.at(id)) ^ ClueKey(id, clue);
+	field_clue_.at(id) = clue;
+}
+void Field::BeginTrial()
+{
+	AddRestorePoint();
+	clue_history_.push_back({ kTrialMarker, kNoClue });
+	++trial_depth_;
+}
+void Field::CommitTrial()
+{
+	--trial_depth_;
+	for (std::size_t i = clue_history_.size(); i-- > 0;) {
+		if (clue_history_[i].first == kTrialMarker) {
+			if (trial_depth_ == 0 && max_clue_frames_ > 0) {
+				// The restore point is kept as a frame
+				clue_history_[i].first = kFrameMarker;
+				DiscardExcessFrames();
+				return;
+			}
+			if (i == 0) clue_history_.clear();
+			else clue_history_.erase(clue_history_.begin() + i);
+			break;
+		}
+	}
+	DiscardRestorePoint();
+}
+void Field::AbortTrial()
+{
+	--trial_depth_;
+	RollbackFrame();
+}
+void Field::RollbackFrame(ClueRemoval *removal)
+{
+	if (removal != nullptr) Rollback(&removal->grid_changes);
+	else Rollback();
+	while (!clue_history_.empty()) {
+		std::pair<int, Clue> last = clue_history_.back();
+		clue_history_.pop_back();
+
+		if (last.first == kTrialMarker || last.first == kFrameMarker) {
+			if (removal != nullptr) removal->clue_changes.push_back(last);
+			break;
+		}
+		if (removal != nullptr) removal->clue_changes.push_back({ last.first, field_clue_.at(last.first) });
+		SetClueById(last.first, last.second);
+	}
+}
+void Field::DiscardExcessFrames()
+{
+	// This is called outside of trials, so every marker is a frame
+	int n_frames = static_cast<int>(std::count_if(clue_history_.begin(), clue_history_.end(), [](const std::pair<int, Clue> &e) { return e.first == kFrameMarker; }));
+	for (; n_frames > max_clue_frames_; --n_frames) {
+		// The oldest frame is merged into the base field
+		std::size_t next_frame = 1;
+		while (next_frame < clue_history_.size() && clue_history_[next_frame].first != kFrameMarker) ++next_frame;
+		clue_history_.erase(clue_history_.begin(), clue_history_.begin() + next_frame);
+		DiscardOldestRestorePoint();
+	}
+}
+void Field::RemoveClue(CellPosition pos, const std::function<void(Field&)> &propagate, ClueRemoval *removal)
+{
+	if (removal != nullptr) {
+		removal->frame_begin = clue_history_.size();
+		removal->grid_changes.history.clear();
+		removal->grid_changes.chains.clear();
+		removal->clue_changes.clear();
+		removal->recomputed_from.reset();
+	}
+	if (GetClue(pos) == kNoClue) return;
+
+	int cell_id = static_cast<int>(CellId(pos));
+	std::size_t frame_begin = clue_history_.size();
+	for (std::size_t i = clue_history_.size(); i-- > 0;) {
+		if (clue_history_[i].first == cell_id) {
+			// The frame which the clue was added in. If there is no such frame, the full rebuild below is used.
+			for (std::size_t j = i + 1; j-- > 0;) {
+				if (clue_history_[j].first == kFrameMarker) {
+					frame_begin = j;
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	if (frame_begin == clue_history_.size()) {
+		// The clue is not in any frame: recompute the field
+		Problem problem(height(), width());
+		for (Y y(0); y < height(); ++y) {
+			for (X x(0); x < width(); ++x) {
+				if (CellPosition(y, x) != pos) problem.SetClue(CellPosition(y, x), GetClue(CellPosition(y, x)));
+			}
+		}
+		int max_clue_frames = max_clue_frames_;
+		if (removal != nullptr) removal->recomputed_from = std::make_shared<Field>(std::move(*this));
+		*this = Field(problem, database_, method_);
+		max_clue_frames_ = max_clue_frames;
+		Propagate(propagate);
+		return;
+	}
+
+	// Clues added in the frames which will be rolled back
+	std::vector<std::pair<int, Clue> > clues_to_replay;
+	for (std::size_t i = frame_begin; i < clue_history_.size(); ++i) {
+		int id = clue_history_[i].first;
+		if (id >= 0 && id != cell_id) clues_to_replay.push_back({ id, field_clue_.at(id) });
+	}
+	if (removal != nullptr) removal->frame_begin = frame_begin;
+	while (clue_history_.size() > frame_begin) RollbackFrame(removal);
+
+	for (auto &c : clues_to_replay) {
+		AddClue(field_clue_.AsPosition(c.first), c.second);
+	}
+	Propagate(propagate);
+}
+void Field::UndoRemoveClue(ClueRemoval *removal)
+{
+	if (removal->recomputed_from) {
+		*this = std::move(*removal->recomputed_from);
+		removal->recomputed_from.reset();
+		return;
+	}
+
+	// Roll back the replayed frames, and then redo what RemoveClue rolled back
+	while (clue_history_.size() > removal->frame_begin) RollbackFrame();
+	Redo(&removal->grid_changes);
+	while (!removal->clue_changes.empty()) {
+		std::pair<int, Clue> next = removal->clue_changes.back();
+		removal->clue_changes.pop_back();
+
+		if (next.first == kTrialMarker || next.first == kFrameMarker) {
+			clue_history_.push_back(next);
+		} else {
+			clue_history_.push_back({ next.first, field_clue_.at(next.first) });
+			SetClueById(next.first, next.second);
+		}
+	}
+}
+void Field::Propagate(const std::function<void(Field&)> &propagate)
+{
+	if (!propagate) return;
+	if (max_clue_frames_ > 0) {
+		BeginTrial();
+		propagate(*this);
+		CommitTrial();
+	} else {
+		propagate(*this);
+	}
+}
+int Field::GetInspectionLevel(LoopPosition pos)
+{
+	// The cells of 0 and 3, whose lookups decide edges most often, come first, and then the other clues.
+	// Vertices are pushed by every decision around them, so they are delayed to coalesce the pushes.
+	// Edges and cells without clues are no-ops for Inspect, hence the last.
+	if (pos.y % 2 == 0 && pos.x % 2 == 0) return 2;
+	if (!(pos.y % 2 == 1 && pos.x % 2 == 1)) return 3;
+	Clue clue = GetClue(CellPosition(pos.y / 2, pos.x / 2));
+	if (clue == kNoClue) return 3;
+	return (clue == Clue(0) || clue == Clue(3)) ? 0 : 1;
+}
 void Field::Inspect(LoopPosition pos)
 {
 	if (!(pos.y % 2 == 1 && pos.x % 2 == 1)) return;
 	if (GetClue(CellPosition(pos.y / 2, pos.x / 2)) == kNoClue) return;
 
 	if (database_ != nullptr && method_.around_cell) {
-		unsigned int db_id = 0;
-		for (int i = 11; i >= 0; --i) {
+		PENCILOID_GRID_LOOP_RULE(kRuleAroundCell);
+		unsigned int line_mask = 0, blank_mask = 0;
+		for (int i = 0; i < 12; ++i) {
 			EdgeState status = GetEdgeSafe(pos + Dictionary::kNeighbor[i]);
-
-			if (status == kEdgeUndecided) db_id = db_id * 3 + Dictionary::kUndecided;
-			else if (status == kEdgeLine) db_id = db_id * 3 + Dictionary::kLine;
-			else if (status == kEdgeBlank) db_id = db_id * 3 + Dictionary::kBlank;
+			line_mask |= (status == kEdgeLine ? 1U : 0U) << i;
+			blank_mask |= (status == kEdgeBlank ? 1U : 0U) << i;
 		}
+		unsigned int db_id = Dictionary::PatternId(line_mask, blank_mask);
 
-		Clue c = GetClue(CellPosition(pos.y / 2, pos.x / 2));
 		unsigned int db_result = database_->Get(db_id, GetClue(CellPosition(pos.y / 2, pos.x / 2)));
 		if (db_result == 0xffffffffU) {
 			SetInconsistent();
 			return;
 		}
 
-		for (int i = 0; i < 12; ++i) {
+		for (int i = 0; i < 12 && (db_result >> (2 * i)) != 0; ++i) {
 			int new_status = (db_result >> (2 * i)) & 3;
 			if (new_status == Dictionary::kLine) {
 				DecideEdge(pos + Dictionary::kNeighbor[i], kEdgeLine);
@@ -113,7 +306,66 @@ void Field::Inspect(LoopPosition pos)
 		}
 	}
 
-	if (method_.diagonal_chain) CheckDiagonalChain(pos);
+	if (database_ != nullptr && method_.around_pair && database_->HasPairTable()) {
+		PENCILOID_GRID_LOOP_RULE(kRuleAroundPair);
+		static const Direction dirs[] = {
+			Direction(Y(0), X(2)),
+			Direction(Y(2), X(0)),
+			Direction(Y(0), X(-2)),
+			Direction(Y(-2), X(0))
+		};
+		for (int i = 0; i < 4; ++i) {
+			LoopPosition pos2 = pos + dirs[i];
+			if (!(0 <= pos2.y && pos2.y <= 2 * height() && 0 <= pos2.x && pos2.x <= 2 * width())) continue;
+			if (GetClue(CellPosition(pos2.y / 2, pos2.x / 2)) == kNoClue) continue;
+
+			if (i < 2) InspectPair(pos, pos2);
+			else InspectPair(pos2, pos);
+			if (IsInconsistent()) return;
+		}
+	}
+
+	if (method_.diagonal_chain) {
+		PENCILOID_GRID_LOOP_RULE(kRuleDiagonalChain);
+		CheckDiagonalChain(pos);
+	}
+}
+void Field::InspectPair(LoopPosition pos1, LoopPosition pos2)
+{
+	// pos1: the left (or upper) cell of the pair, pos2: the other one
+	bool vertical = pos1.x == pos2.x;
+	LoopPosition edges[9];
+	for (int i = 0; i < 9; ++i) {
+		Direction d = Dictionary::kPairNeighbor[i];
+		edges[i] = vertical ? pos1 + Direction(Y(static_cast<int>(d.x)), X(static_cast<int>(d.y))) : pos1 + d;
+	}
+
+	unsigned int line_mask = 0, blank_mask = 0;
+	for (int i = 0; i < 9; ++i) {
+		EdgeState status = GetEdgeSafe(edges[i]);
+		line_mask |= (status == kEdgeLine ? 1U : 0U) << i;
+		blank_mask |= (status == kEdgeBlank ? 1U : 0U) << i;
+	}
+
+	unsigned int db_result = database_->GetPair(Dictionary::PatternId(line_mask, blank_mask),
+		GetClue(CellPosition(pos1.y / 2, pos1.x / 2)), GetClue(CellPosition(pos2.y / 2, pos2.x / 2)));
+	if (db_result == 0xffffffffU) {
+		SetInconsistent();
+		return;
+	}
+
+	for (int i = 0; i < 9 && (db_result >> (2 * i)) != 0; ++i) {
+		int new_status = (db_result >> (2 * i)) & 3;
+		if (new_status == Dictionary::kLine) {
+			DecideEdge(edges[i], kEdgeLine);
+		}
+		if (new_status == Dictionary::kBlank) {
+			LoopPosition edge_pos = edges[i];
+			if (0 <= edge_pos.y && edge_pos.y <= 2 * height() && 0 <= edge_pos.x && edge_pos.x <= 2 * width()) {
+				DecideEdge(edge_pos, kEdgeBlank);
+			}
+		}
+	}
 }
 void Field::ApplyTheorem(LoopPosition pos)
 {
@@ -128,6 +380,7 @@ void Field::ApplyTheorem(LoopPosition pos)
 	if (GetClue(CellPosition(pos.y / 2, pos.x / 2)) == 3) {
 		// Adjacent 3s
 		if (method_.adjacent_3) {
+			PENCILOID_GRID_LOOP_RULE(kRuleAdjacent3);
 			for (int i = 0; i < 4; ++i) {
 				CellPosition pos2 = CellPosition(pos.y / 2, pos.x / 2) + dir[i];
 				if (0 <= pos2.y && pos2.y < height() && 0 <= pos2.x && pos2.x < width() && GetClue(pos2) == 3) {
@@ -142,6 +395,7 @@ void Field::ApplyTheorem(LoopPosition pos)
 		
 		// Diagonal 3s
 		if (method_.diagonal_3) {
+			PENCILOID_GRID_LOOP_RULE(kRuleDiagonal3);
 			for (int i = 0; i < 4; ++i) {
 				CellPosition pos2 = CellPosition(pos.y / 2, pos.x / 2) + dir[i] + dir[(i + 1) & 3];
 				if (0 <= pos2.y && pos2.y < height() && 0 <= pos2.x && pos2.x < width() && GetClue(pos2) == 3) {
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "../common/grid_loop.h"
 #include "../common/grid.h"
@@ -30,7 +33,40 @@ public:
 	void AddClue(CellPosition cell, Clue clue);
 	inline Clue GetClue(CellPosition cell) { return field_clue_(cell); }
 
+	// Zobrist hash of the clues currently in the field, maintained incrementally (including trials and removals).
+	unsigned long long GetClueHash() const { return clue_hash_; }
+
 	void Inspect(LoopPosition pos);
+	int GetInspectionLevel(LoopPosition pos);
+
+	// Start a trial move. Changes made after this (including added clues) can be
+	// undone by AbortTrial() or kept by CommitTrial(). Trials can be nested.
+	void BeginTrial();
+	void CommitTrial();
+	void AbortTrial();
+
+	// Keep the deductions of each clue added after this call (outside of trials, or by the outermost committed trial)
+	// as a separate frame of the history, so that RemoveClue() can retract them without recomputing the whole field.
+	// At most <max_frames> frames are kept. Beyond that, the oldest frame is merged into the base field.
+	void EnableClueRemoval(int max_frames) { max_clue_frames_ = max_frames; }
+
+	// Remove the clue of <cell>.
+	// This is chronological backtracking, not a retraction of only the deductions depending on the clue:
+	// the field is rolled back to the frame in which the clue was added, the clues of the later frames are added again
+	// (one frame for each), and then <propagate> is applied in another frame to redo the deductions beyond the propagation
+	// of clues (e.g. the trial-and-error technique) which were rolled back. Hence the cost is proportional to
+	// the deductions made after the clue was added, plus one run of <propagate>.
+	// If the clue is in no frame (added before EnableClueRemoval(), or its frame was merged), the field is
+	// recomputed from the remaining clues, and <propagate> is applied to it.
+	// This should not be called during a trial.
+	// If <removal> is given, what is needed to undo the removal is recorded to it.
+	struct ClueRemoval;
+	void RemoveClue(CellPosition cell, const std::function<void(Field&)> &propagate = std::function<void(Field&)>(), ClueRemoval *removal = nullptr);
+
+	// Restore the field exactly as it was before the RemoveClue() which recorded <removal>.
+	// Changes made after that RemoveClue() should have been undone by AbortTrial().
+	// The cost is that of the rollback of the replayed frames, plus that of the rollback done in RemoveClue().
+	void UndoRemoveClue(ClueRemoval *removal);
 
 	void SetDatabase(Dictionary* database) { database_ = database; }
 	Dictionary* GetDatabase() { return database_; }
@@ -47,12 +83,38 @@ private:
 	Dictionary *database_;
 	Method method_;
 
+	// (cell id, previous clue) for each clue added during trials or frames.
+	// kTrialMarker / kFrameMarker marks the beginning of a trial / frame. Each of them corresponds to a restore point.
+	static const int kTrialMarker = -1;
+	static const int kFrameMarker = -2;
+	std::vector<std::pair<int, Clue> > clue_history_;
+	int trial_depth_;
+	int max_clue_frames_; // 0 if clue removal is not enabled
+	unsigned long long clue_hash_;
+
+	void AddClueInternal(CellPosition cell, Clue clue);
+	void SetClueById(int id, Clue clue);
+	void RollbackFrame(ClueRemoval *removal = nullptr);
+	void DiscardExcessFrames();
+	void Propagate(const std::function<void(Field&)> &propagate);
+
 	unsigned int CellId(CellPosition pos) { return field_clue_.GetIndex(pos); }
 
 	void ApplyTheorem(LoopPosition pos);
+	void InspectPair(LoopPosition pos1, LoopPosition pos2);
 	void CheckDiagonalChain(LoopPosition pos);
 };
 
+struct Field::ClueRemoval
+{
+	std::size_t frame_begin;
+	RedoLog grid_changes;
+	// (cell id or marker, clue before the rollback) for each entry rolled back from clue_history_, latest first
+	std::vector<std::pair<int, Clue> > clue_changes;
+	// The field before the removal, if it was recomputed
+	std::shared_ptr<Field> recomputed_from;
+};
+
 std::ostream& operator<<(std::ostream &stream, Field &field);
 
 }
@@ -3,14 +3,17 @@
 #include <vector>
 #include <algorithm>
 #include <random>
-#include <map>
+#include <atomic>
 
 #include "sl_problem.h"
 #include "sl_field.h"
 #include "sl_clue_placement.h"
 #include "sl_generator_option.h"
 #include "../common/grid_loop_helper.h"
+#include "../common/grid_loop_lookahead.h"
 #include "../common/union_find.h"
+#include "../common/thread_pool.h"
+#include "../common/hash_counter.h"
 
 namespace penciloid
 {
@@ -51,18 +54,6 @@ bool HasZeroNearby(Field &field, CellPosition pos)
 
 	return false;
 }
-long long FieldHash(Field &field, long long hash_size)
-{
-	long long ret = 0;
-	for (Y y(0); y < field.height(); ++y) {
-		for (X x(0); x < field.width(); ++x) {
-			Clue c = field.GetClue(CellPosition(y, x));
-			if (c == kNoClue) ret = (ret * 7) % hash_size;
-			else ret = (ret * 7 + c + 1) % hash_size;
-		}
-	}
-	return ret;
-}
 int CountProhibitedPattern(const CluePlacement &placement, Field &field)
 {
 	static const Direction kDirs[] = {
@@ -128,6 +119,90 @@ int CountProhibitedPattern(const CluePlacement &placement, Field &field)
 	}
 	return ret;
 }
+// Runs the trial-and-error technique on <field> as specified by <constraint>.
+void RunAssumption(Field &field, const GeneratorOption &constraint, ThreadPool *assumption_pool)
+{
+	if (!constraint.use_assumption) return;
+	const LookaheadOption &lookahead = constraint.assumption;
+	if (lookahead.depth <= 1 && lookahead.max_probes == 0 && lookahead.time_limit == 0 && lookahead.ordering == LookaheadOption::kOrderRowMajor) {
+		Assume(&field, assumption_pool);
+	} else {
+		Lookahead(&field, lookahead);
+	}
+}
+struct StepContext
+{
+	const CluePlacement &placement;
+	const GeneratorOption &constraint;
+	const HashCounter &hash_count;
+	ThreadPool *assumption_pool; // nullptr if the trial-and-error technique runs in the calling thread
+	Field::EdgeCount previous_decided_edges;
+	double temperature;
+};
+struct CandidateResult
+{
+	Clue clue;
+	Field::EdgeCount decided_edges;
+	unsigned long long hash;
+};
+// Tries the clues in <candidates> in order at <pos>, which must have no clue in <field>.
+// If one of them is accepted, it is left on <field> as an uncommitted trial and true is returned. Otherwise <field> is unchanged.
+// <transition_rnd(i)> should give the random number in [0, 1) which decides the transition to <candidates[i]>.
+template <class TransitionRandom>
+bool TryClueCandidates(const StepContext &ctx, Field &field, CellPosition pos, const std::vector<Clue> &candidates, TransitionRandom transition_rnd, CandidateResult *res)
+{
+	for (int i = 0; i < static_cast<int>(candidates.size()); ++i) {
+		Clue new_clue = candidates[i];
+
+		field.BeginTrial();
+		field.AddClue(pos, new_clue);
+
+		RunAssumption(field, ctx.constraint, ctx.assumption_pool);
+
+		if (field.IsInconsistent()) {
+			field.AbortTrial();
+			continue;
+		}
+
+		unsigned long long next_hash = field.GetClueHash();
+		bool tabu_collision = ctx.hash_count.Get(next_hash) >= 5;
+		if (tabu_collision) {
+			field.AbortTrial();
+			continue;
+		}
+
+		bool transition = false;
+		Field::EdgeCount next_decided_edges = field.GetNumberOfDecidedEdges();
+		next_decided_edges -= CountProhibitedPattern(ctx.placement, field) * 10;
+		if (ctx.previous_decided_edges < next_decided_edges) {
+			transition = true;
+		} else {
+			double transition_probability = exp(static_cast<double>(static_cast<int>(next_decided_edges) - static_cast<int>(ctx.previous_decided_edges)) / ctx.temperature);
+			if (transition_rnd(i) < transition_probability) transition = true;
+		}
+
+		if (!transition) {
+			field.AbortTrial();
+			continue;
+		}
+
+		field.BeginTrial();
+		ApplyInOutRule(&field);
+		CheckConnectability(&field);
+		bool in_out_inconsistent = field.IsInconsistent();
+		field.AbortTrial();
+		if (in_out_inconsistent) {
+			field.AbortTrial();
+			continue;
+		}
+
+		res->clue = new_clue;
+		res->decided_edges = next_decided_edges;
+		res->hash = next_hash;
+		return true;
+	}
+	return false;
+}
 }
 
 bool GenerateByLocalSearch(const CluePlacement &placement, const GeneratorOption &constraint, std::mt19937 *rnd, Problem *ret)
@@ -141,10 +216,12 @@ bool GenerateByLocalSearch(const CluePlacement &placement, const GeneratorOption
 	int max_step = static_cast<int>(height) * static_cast<int>(width) * 10;
 
 	const int kTabuSize = 8;
-	const long long kTabuHashSize = 1e9 + 7;
-	long long tabu_list[kTabuSize];
-	for (int i = 0; i < kTabuSize; ++i) tabu_list[i] = -1;
-	std::map<long long, int> hash_count;
+	unsigned long long tabu_list[kTabuSize];
+	for (int i = 0; i < kTabuSize; ++i) tabu_list[i] = 0;
+
+	// At most one hash is added in each step. The table is kept per thread so that its memory is reused over generations.
+	static thread_local HashCounter hash_count;
+	hash_count.Clear(max_step);
 
 	int number_unplaced_clues = 0;
 	for (Y y(0); y < height; ++y) {
@@ -155,9 +232,26 @@ bool GenerateByLocalSearch(const CluePlacement &placement, const GeneratorOption
 		}
 	}
 
-	Field latest_field(current_problem, constraint.field_dictionary, constraint.method);
 	Field::EdgeCount previous_decided_edges = 0;
 
+	// Each worker evaluates candidates on its own replica of the field, and the replicas are identical between steps.
+	// ThreadPool(1) runs the jobs in the calling thread, so a single worker updates its field in place without any copy.
+	int n_workers = std::max(constraint.n_evaluation_threads, 1);
+	ThreadPool pool(n_workers);
+	std::vector<Field> worker_fields(n_workers, Field(current_problem, constraint.field_dictionary, constraint.method));
+	Field &latest_field = worker_fields[0];
+	// Each frame holds one of the clues placed by the search. The deductions of the trial-and-error technique
+	// rolled back by RemoveClue are made again by the trial of the next clue, so no <propagate> is given to it.
+	for (Field &field : worker_fields) field.EnableClueRemoval(number_unplaced_clues);
+	std::vector<Field::ClueRemoval> worker_removals(n_workers);
+	// The position index whose accepted trial is left open on the field of each worker, or -1
+	std::vector<int> worker_accepted(n_workers, -1);
+
+	// The workers of <pool> can't share another pool, so parallel Assume is used only if the candidates are evaluated one by one
+	int n_assumption_workers = (n_workers == 1 && constraint.use_assumption) ? std::max(constraint.n_assumption_threads, 1) : 1;
+	ThreadPool assumption_pool(n_assumption_workers);
+	ThreadPool *assumption_pool_ptr = n_assumption_workers > 1 ? &assumption_pool : nullptr;
+
 	int no_progress = 0;
 	int step = 0;
 
@@ -178,76 +272,78 @@ bool GenerateByLocalSearch(const CluePlacement &placement, const GeneratorOption
 
 		std::shuffle(position_candidates.begin(), position_candidates.end(), *rnd);
 
-		for (CellPosition &pos : position_candidates) {
+		StepContext ctx = { placement, constraint, hash_count, assumption_pool_ptr, previous_decided_edges, temperature };
+		CellPosition accepted_pos;
+		Clue accepted_previous_clue = kNoClue;
+		CandidateResult accepted;
+
+		// All random numbers are drawn beforehand, and the earliest accepted position in <position_candidates> is taken,
+		// so that the result depends neither on the number of workers nor on the order in which they finish.
+		int n_positions = position_candidates.size();
+		std::vector<std::vector<Clue> > clue_candidates(n_positions);
+		std::vector<std::vector<float> > transition_rnds(n_positions);
+		for (int i = 0; i < n_positions; ++i) {
+			CellPosition pos = position_candidates[i];
 			Clue previous_clue = current_problem.GetClue(pos);
 			bool is_zero_ok = !HasZeroNearby(latest_field, pos);
 
-			std::vector<Clue> new_clue_candidates;
 			for (Clue c(is_zero_ok ? 0 : 1); c <= 3; ++c) {
-				if (c != previous_clue) new_clue_candidates.push_back(c);
+				if (c != previous_clue) clue_candidates[i].push_back(c);
 			}
+			std::shuffle(clue_candidates[i].begin(), clue_candidates[i].end(), *rnd);
+			for (std::size_t j = 0; j < clue_candidates[i].size(); ++j) transition_rnds[i].push_back(real_rnd(*rnd));
+		}
 
-			std::shuffle(new_clue_candidates.begin(), new_clue_candidates.end(), *rnd);
-
-			Field common;
-
-			if (previous_clue == kNoClue) common = latest_field;
-			else {
-				current_problem.SetClue(pos, kNoClue);
-				common = Field(current_problem, constraint.field_dictionary, constraint.method);
-			}
-
-			for (Clue new_clue : new_clue_candidates) {
-				current_problem.SetClue(pos, new_clue);
-
-				Field next_field_candidate(common);
-				next_field_candidate.AddClue(pos, new_clue);
-
-				if (constraint.use_assumption) Assume(&next_field_candidate);
-
-				if (next_field_candidate.IsInconsistent()) continue;
-
-				long long next_hash = FieldHash(next_field_candidate, kTabuHashSize);
-				bool tabu_collision = hash_count[next_hash] >= 5; // false;
-				if (tabu_collision) continue;
-
-				bool transition = false;
-				Field::EdgeCount next_decided_edges = next_field_candidate.GetNumberOfDecidedEdges();
-				next_decided_edges -= CountProhibitedPattern(placement, next_field_candidate) * 10;
-				if (previous_decided_edges < next_decided_edges) {
-					transition = true;
-				} else {
-					double transition_probability = exp(static_cast<double>(static_cast<int>(next_decided_edges) - static_cast<int>(previous_decided_edges)) / temperature);
-					if (real_rnd(*rnd) < transition_probability) transition = true;
-				}
-
-				if (!transition) continue;
-
-				Field in_out_test_field = next_field_candidate;
-				ApplyInOutRule(&in_out_test_field);
-				CheckConnectability(&in_out_test_field);
-				if (in_out_test_field.IsInconsistent()) {
-					continue;
-				}
-
-				// update field & problem
-				if (previous_clue == kNoClue) --number_unplaced_clues;
-				previous_decided_edges = next_decided_edges;
-				is_progress = true;
-				latest_field = next_field_candidate;
-
-				for (int i = 1; i < kTabuSize; ++i) tabu_list[i - 1] = tabu_list[i];
-				tabu_list[kTabuSize - 1] = next_hash;
-				hash_count[next_hash] += 1;
+		std::vector<CandidateResult> results(n_positions);
+		std::atomic<int> earliest_accepted(n_positions);
+		pool.ParallelFor(n_positions, [&](int worker, int i) {
+			if (earliest_accepted.load() < i) return;
 
-				break;
+			Field &field = worker_fields[worker];
+			CellPosition pos = position_candidates[i];
+			Clue previous_clue = current_problem.GetClue(pos);
+			if (previous_clue != kNoClue) field.RemoveClue(pos, nullptr, &worker_removals[worker]);
+
+			if (TryClueCandidates(ctx, field, pos, clue_candidates[i], [&](int j) { return transition_rnds[i][j]; }, &results[i])) {
+				// The trial is kept so that it can be committed if this position is taken.
+				// The later positions are skipped by this worker, since they are never taken.
+				worker_accepted[worker] = i;
+				int current = earliest_accepted.load();
+				while (i < current && !earliest_accepted.compare_exchange_weak(current, i));
+				return;
 			}
 
-			if (is_progress) break;
-			else current_problem.SetClue(pos, previous_clue);
+			// The field is restored in place: the cost is proportional to the edges changed since the frame of the clue
+			if (previous_clue != kNoClue) field.UndoRemoveClue(&worker_removals[worker]);
+		});
+
+		if (earliest_accepted < n_positions) {
+			accepted_pos = position_candidates[earliest_accepted];
+			accepted_previous_clue = current_problem.GetClue(accepted_pos);
+			accepted = results[earliest_accepted];
+
+			// The accepted trial is committed as it is, and the other replicas (including those left with
+			// trials of later positions) take it over by copying, which copies nothing if there is only one worker.
+			int winner = 0;
+			while (worker_accepted[winner] != earliest_accepted) ++winner;
+			worker_fields[winner].CommitTrial();
+			pool.ParallelFor(n_workers, [&](int, int i) {
+				if (i != winner) worker_fields[i] = worker_fields[winner];
+			});
+			is_progress = true;
 		}
-
-		if (!is_progress) {
+		std::fill(worker_accepted.begin(), worker_accepted.end(), -1);
+
+		if (is_progress) {
+			// update problem
+			current_problem.SetClue(accepted_pos, accepted.clue);
+			if (accepted_previous_clue == kNoClue) --number_unplaced_clues;
+			previous_decided_edges = accepted.decided_edges;
+
+			for (int i = 1; i < kTabuSize; ++i) tabu_list[i - 1] = tabu_list[i];
+			tabu_list[kTabuSize - 1] = accepted.hash;
+			hash_count.Increment(accepted.hash);
+		} else {
 			++no_progress;
 			if (no_progress >= 20) break;
 		}
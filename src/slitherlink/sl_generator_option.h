@@ -2,6 +2,7 @@
 
 #include "sl_dictionary.h"
 #include "sl_method.h"
+#include "../common/grid_loop_lookahead.h"
 
 namespace penciloid
 {
@@ -9,11 +10,25 @@ namespace slitherlink
 {
 struct GeneratorOption
 {
-	GeneratorOption() : use_assumption(false), method(), field_dictionary(nullptr) {}
+	GeneratorOption() : use_assumption(false), method(), field_dictionary(nullptr), n_evaluation_threads(1), n_assumption_threads(1) {}
 
 	bool use_assumption;
+
+	// The depth, the budget and the ordering of the trial-and-error technique.
+	// With the default value, Assume is used (in parallel if n_assumption_threads is more than 1).
+	// The result depends on the speed of the machine if assumption.time_limit is set.
+	LookaheadOption assumption;
+
 	Method method;
 	Dictionary *field_dictionary;
+
+	// The number of threads used to evaluate the candidates of each local search step.
+	// The result depends only on the random generator, not on the number of threads.
+	int n_evaluation_threads;
+
+	// The number of threads used by the trial-and-error technique (only if n_evaluation_threads is 1 and <assumption> is the default).
+	// The result doesn't depend on this.
+	int n_assumption_threads;
 };
 }
 }
\ No newline at end of file
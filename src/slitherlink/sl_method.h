@@ -9,20 +9,22 @@ namespace slitherlink
 struct Method
 {
 	Method() :
-		around_cell(true), adjacent_3(true), diagonal_3(true), diagonal_chain(true)
+		around_cell(true), around_pair(true), adjacent_3(true), diagonal_3(true), diagonal_chain(true)
 	{}
 
 	void DisableAll()
 	{
 		grid_loop_method.DisableAll();
 		around_cell = false;
+		around_pair = false;
 		adjacent_3 = false;
 		diagonal_3 = false;
 		diagonal_chain = false;
 	}
 
 	GridLoopMethod grid_loop_method;
-	bool around_cell, adjacent_3, diagonal_3, diagonal_chain;
+	// around_pair is effective only if the dictionary has the pair table (Dictionary::CreatePairTable)
+	bool around_cell, around_pair, adjacent_3, diagonal_3, diagonal_chain;
 };
 }
 }
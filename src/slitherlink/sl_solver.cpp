@@ -0,0 +1,179 @@
+#include "sl_solver.h"
+
+#include <algorithm>
+
+#include "../common/grid_loop_lookahead.h"
+#include "../common/thread_pool.h"
+
+namespace penciloid
+{
+namespace slitherlink
+{
+Solver::Solver(Dictionary *dictionary, const Method &method, const SolverOption &option)
+	: dictionary_(dictionary), method_(method), option_(option), solutions_(), n_nodes_(0), stop_(false), aborted_(false)
+{
+}
+int Solver::Solve(const Problem &problem)
+{
+	return Solve(Field(problem, dictionary_, method_));
+}
+int Solver::Solve(const Field &field)
+{
+	solutions_.clear();
+	n_nodes_ = 0;
+	stop_ = false;
+	aborted_ = false;
+
+	Field root = field;
+	int n_threads = std::max(option_.n_threads, 1);
+	if (n_threads == 1) {
+		Search(root);
+		return GetNumberOfSolutions();
+	}
+
+	// Split the search tree into (at most) 2^depth subtrees, several times as many as the threads
+	int depth = 0;
+	while ((1 << depth) < n_threads * 8) ++depth;
+	std::vector<Decision> path;
+	std::vector<std::vector<Decision> > tasks;
+	Split(root, depth, path, tasks);
+
+	ThreadPool pool(n_threads);
+	std::vector<Field> worker_fields(n_threads, root);
+	pool.ParallelFor(static_cast<int>(tasks.size()), [&](int worker, int i) {
+		if (stop_) return;
+		Field &worker_field = worker_fields[worker];
+		worker_field.AddRestorePoint();
+		for (const Decision &d : tasks[i]) worker_field.DecideEdge(d.edge, d.status);
+		Search(worker_field);
+		worker_field.Rollback();
+	});
+
+	return GetNumberOfSolutions();
+}
+bool Solver::EnterNode(Field &field)
+{
+	if (stop_) return false;
+	long long node = ++n_nodes_;
+	if (option_.max_nodes > 0 && node > option_.max_nodes) {
+		aborted_ = true;
+		stop_ = true;
+		return false;
+	}
+
+	if (option_.use_assumption && !field.IsInconsistent() && !field.IsFullySolved()) {
+		// Lookahead works on the field in place, so the history of the search isn't copied
+		Lookahead(&field, LookaheadOption());
+	}
+	if (field.IsInconsistent()) return false;
+	if (field.IsFullySolved()) {
+		if (IsValidSolution(field)) RecordSolution(field);
+		return false;
+	}
+	return true;
+}
+void Solver::Search(Field &field)
+{
+	if (!EnterNode(field)) return;
+
+	LoopPosition edge = SelectEdge(field);
+	if (edge.y < 0) return; // every edge is decided, but the lines don't form a loop
+
+	for (auto status : { Field::kEdgeLine, Field::kEdgeBlank }) {
+		field.AddRestorePoint();
+		field.DecideEdge(edge, status);
+		Search(field);
+		field.Rollback();
+		if (stop_) return;
+	}
+}
+void Solver::Split(Field &field, int depth, std::vector<Decision> &path, std::vector<std::vector<Decision> > &tasks)
+{
+	if (depth == 0) {
+		tasks.push_back(path);
+		return;
+	}
+	if (!EnterNode(field)) return;
+
+	LoopPosition edge = SelectEdge(field);
+	if (edge.y < 0) return;
+
+	for (auto status : { Field::kEdgeLine, Field::kEdgeBlank }) {
+		field.AddRestorePoint();
+		field.DecideEdge(edge, status);
+		path.push_back({ edge, status });
+		Split(field, depth - 1, path, tasks);
+		path.pop_back();
+		field.Rollback();
+		if (stop_) return;
+	}
+}
+LoopPosition Solver::SelectEdge(Field &field)
+{
+	Y height = field.height();
+	X width = field.width();
+
+	if (option_.branching == SolverOption::kBranchLooseEnd) {
+		// An undecided edge at a vertex with exactly one line
+		static const Direction dirs[] = {
+			Direction(Y(-1), X(0)), Direction(Y(0), X(-1)), Direction(Y(1), X(0)), Direction(Y(0), X(1))
+		};
+		for (Y y(0); y <= 2 * height; y += 2) {
+			for (X x(0); x <= 2 * width; x += 2) {
+				LoopPosition vertex(y, x);
+				int n_lines = 0;
+				LoopPosition undecided(Y(-1), X(-1));
+				for (Direction d : dirs) {
+					Field::EdgeState status = field.GetEdgeSafe(vertex + d);
+					if (status == Field::kEdgeLine) ++n_lines;
+					else if (status == Field::kEdgeUndecided && undecided.y < 0) undecided = vertex + d;
+				}
+				if (n_lines == 1 && undecided.y >= 0) return undecided;
+			}
+		}
+	}
+
+	for (Y y(0); y <= 2 * height; ++y) {
+		for (X x(0); x <= 2 * width; ++x) {
+			if (static_cast<int>(y % 2) != static_cast<int>(x % 2) && field.GetEdge(LoopPosition(y, x)) == Field::kEdgeUndecided) {
+				return LoopPosition(y, x);
+			}
+		}
+	}
+	return LoopPosition(Y(-1), X(-1));
+}
+bool Solver::IsValidSolution(Field &field)
+{
+	// The propagation with a restricted Method or Dictionary may miss violations of the rules
+	Y height = field.height();
+	X width = field.width();
+	static const Direction dirs[] = {
+		Direction(Y(-1), X(0)), Direction(Y(0), X(-1)), Direction(Y(1), X(0)), Direction(Y(0), X(1))
+	};
+	for (Y y(0); y <= 2 * height; ++y) {
+		for (X x(0); x <= 2 * width; ++x) {
+			if (static_cast<int>(y % 2) != static_cast<int>(x % 2)) continue;
+			LoopPosition pos(y, x);
+			int n_lines = 0;
+			for (Direction d : dirs) {
+				if (field.GetEdgeSafe(pos + d) == Field::kEdgeLine) ++n_lines;
+			}
+			if (y % 2 == 0) {
+				if (n_lines != 0 && n_lines != 2) return false;
+			} else {
+				Clue clue = field.GetClue(CellPosition(y / 2, x / 2));
+				if (clue != kNoClue && clue != n_lines) return false;
+			}
+		}
+	}
+	return true;
+}
+void Solver::RecordSolution(const Field &field)
+{
+	std::lock_guard<std::mutex> lock(solutions_mutex_);
+	if (static_cast<int>(solutions_.size()) >= option_.max_solutions) return;
+	solutions_.push_back(field);
+	if (static_cast<int>(solutions_.size()) >= option_.max_solutions) stop_ = true;
+}
+}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include "sl_problem.h"
+#include "sl_field.h"
+#include "sl_dictionary.h"
+#include "sl_method.h"
+
+namespace penciloid
+{
+namespace slitherlink
+{
+struct SolverOption
+{
+	enum Branching
+	{
+		kBranchRowMajor, // the first undecided edge in the row-major order
+		kBranchLooseEnd  // an undecided edge extending a chain of lines (if any), so that the lines are traced
+	};
+
+	SolverOption() : max_solutions(2), n_threads(1), use_assumption(true), branching(kBranchLooseEnd), max_nodes(0) {}
+
+	// The search stops as soon as this number of solutions are found. 2 is enough to check the uniqueness.
+	int max_solutions;
+
+	// If this is more than 1, the search tree is split into subtrees, which are searched in parallel.
+	// The number of solutions (up to <max_solutions>) doesn't depend on this, but which of them are found may.
+	int n_threads;
+
+	// Run the trial-and-error technique of depth 1 on each node of the search tree.
+	bool use_assumption;
+
+	Branching branching;
+
+	// The maximum number of nodes of the search tree, or 0 for no limit.
+	long long max_nodes;
+};
+
+// A complete solver by depth-first search over Field.
+class Solver
+{
+public:
+	Solver(Dictionary *dictionary = nullptr, const Method &method = Method(), const SolverOption &option = SolverOption());
+
+	// Searches the solutions of <problem> (or <field>), and returns the number of found solutions.
+	int Solve(const Problem &problem);
+	int Solve(const Field &field);
+
+	int GetNumberOfSolutions() const { return static_cast<int>(solutions_.size()); }
+	const Field &GetSolution(int i) const { return solutions_[i]; }
+
+	// True if the solution is unique. This is valid only if <max_solutions> is 2 or more and the search wasn't aborted.
+	bool IsUnique() const { return solutions_.size() == 1 && !aborted_; }
+
+	// True if the search stopped due to <max_nodes>. In this case, the solutions found so far are kept.
+	bool IsAborted() const { return aborted_; }
+
+	long long GetNumberOfNodes() const { return n_nodes_; }
+
+private:
+	struct Decision
+	{
+		LoopPosition edge;
+		Field::EdgeState status;
+	};
+
+	// Enters a new node of the search tree. Returns false if the node shouldn't be searched.
+	bool EnterNode(Field &field);
+	void Search(Field &field);
+	// Search <field> up to <depth> levels, leaving the unsearched nodes in <tasks> as the sequences of decisions from the root.
+	void Split(Field &field, int depth, std::vector<Decision> &path, std::vector<std::vector<Decision> > &tasks);
+
+	LoopPosition SelectEdge(Field &field);
+	bool IsValidSolution(Field &field);
+	void RecordSolution(const Field &field);
+
+	Dictionary *dictionary_;
+	Method method_;
+	SolverOption option_;
+
+	std::vector<Field> solutions_;
+	std::mutex solutions_mutex_;
+	std::atomic<long long> n_nodes_;
+	std::atomic<bool> stop_, aborted_;
+};
+}
+}
\ No newline at end of file
@@ -10,6 +10,9 @@ void RunAllTest()
 	RunAllGraphSeparationTest();
 	RunAllSlitherlinkFieldTest();
 	RunAllSlitherlinkDictionaryTest();
+	RunAllSlitherlinkBitboardFieldTest();
+	RunAllSlitherlinkSolverTest();
+	RunAllSlitherlinkGeneratorTest();
 	RunAllAkariProblemTest();
 	RunAllAkariFieldTest();
 	RunAllYajilinProblemTest();
@@ -17,6 +20,7 @@ void RunAllTest()
 	RunAllMasyuFieldTest();
 	RunAllNurikabeFieldTest();
 	RunAllKakuroFieldTest();
+	RunAllNumberlinkFieldTest();
 }
 }
 }
\ No newline at end of file
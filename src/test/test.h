@@ -8,6 +8,9 @@ void RunAllTest();
 void RunAllGridLoopTest();
 void RunAllSlitherlinkFieldTest();
 void RunAllSlitherlinkDictionaryTest();
+void RunAllSlitherlinkBitboardFieldTest();
+void RunAllSlitherlinkSolverTest();
+void RunAllSlitherlinkGeneratorTest();
 void RunAllAkariProblemTest();
 void RunAllAkariFieldTest();
 void RunAllYajilinProblemTest();
@@ -16,5 +19,6 @@ void RunAllMasyuFieldTest();
 void RunAllNurikabeFieldTest();
 void RunAllGraphSeparationTest();
 void RunAllKakuroFieldTest();
+void RunAllNumberlinkFieldTest();
 }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "test.h"
 
 #include <cassert>
+#include <vector>
 
 #include "../common/grid_loop.h"
 
@@ -9,6 +10,21 @@ namespace penciloid
 {
 namespace test
 {
+namespace
+{
+// GridLoop which records the positions passed to Inspect
+class InspectRecorder : public GridLoop<InspectRecorder>
+{
+public:
+	InspectRecorder(Y height, X width) : GridLoop<InspectRecorder>(height, width), inspected() {}
+
+	void Inspect(LoopPosition pos) { inspected.push_back(pos); }
+	// Cells first, then edges, then vertices (only with GridLoopMethod::prioritized_queue)
+	int GetInspectionLevel(LoopPosition pos) { return 2 - (static_cast<int>(pos.y % 2) + static_cast<int>(pos.x % 2)); }
+
+	std::vector<LoopPosition> inspected;
+};
+}
 void RunAllGridLoopTest()
 {
 	GridLoopBasicAccessors();
@@ -19,6 +35,9 @@ void RunAllGridLoopTest()
 	GridLoopHourglassRule();
 	GridLoopComplexAccessors();
 	GridLoopChainIdentifier();
+	GridLoopRollback();
+	GridLoopCheckAll();
+	GridLoopPrioritizedQueue();
 }
 void GridLoopBasicAccessors()
 {
@@ -195,5 +214,99 @@ void GridLoopChainIdentifier()
 	field.DecideEdge(LoopPosition(Y(0), X(3)), PlainGridLoop::kEdgeBlank);
 	assert(field.GetChainIdentifier(LoopPosition(Y(0), X(1))) == field.GetChainIdentifier(LoopPosition(Y(1), X(2))));
 }
+void GridLoopRollback()
+{
+	PlainGridLoop field(Y(5), X(6));
+
+	field.DecideEdge(LoopPosition(Y(0), X(1)), PlainGridLoop::kEdgeLine);
+	PlainGridLoop::EdgeCount decided_edges = field.GetNumberOfDecidedEdges();
+	PlainGridLoop::EdgeCount decided_lines = field.GetNumberOfDecidedLines();
+
+	field.AddRestorePoint();
+	field.DecideEdge(LoopPosition(Y(5), X(6)), PlainGridLoop::kEdgeLine);
+	field.DecideEdge(LoopPosition(Y(6), X(5)), PlainGridLoop::kEdgeLine);
+	field.DecideEdge(LoopPosition(Y(10), X(11)), PlainGridLoop::kEdgeBlank);
+	assert(field.GetEdge(LoopPosition(Y(5), X(6))) == PlainGridLoop::kEdgeLine);
+	assert(field.GetEdge(LoopPosition(Y(6), X(7))) == PlainGridLoop::kEdgeBlank);
+	assert(field.GetEdge(LoopPosition(Y(7), X(6))) == PlainGridLoop::kEdgeBlank);
+	assert(field.GetEdge(LoopPosition(Y(9), X(12))) == PlainGridLoop::kEdgeBlank);
+
+	field.Rollback();
+	for (Y y(0); y <= 10; ++y) {
+		for (X x(0); x <= 12; ++x) {
+			if (static_cast<int>(y % 2) == static_cast<int>(x % 2)) continue;
+			PlainGridLoop::EdgeState expected = PlainGridLoop::kEdgeUndecided;
+			if ((y == 0 && x == 1) || (y == 1 && x == 0)) expected = PlainGridLoop::kEdgeLine;
+			assert(field.GetEdge(LoopPosition(y, x)) == expected);
+		}
+	}
+	assert(field.GetNumberOfDecidedEdges() == decided_edges);
+	assert(field.GetNumberOfDecidedLines() == decided_lines);
+	assert(field.GetAnotherEnd(LoopPosition(Y(4), X(6)), Direction(Y(1), X(0))) == LoopPosition(Y(6), X(6)));
+}
+void GridLoopCheckAll()
+{
+	const Y height(3);
+	const X width(4);
+
+	// Each kind of positions should be inspected exactly once, in the row-major order
+	for (int kind = 0; kind < 3; ++kind) {
+		InspectRecorder field(height, width);
+		if (kind == 0) field.CheckAllVertex();
+		else if (kind == 1) field.CheckAllCell();
+		else field.CheckAllEdge();
+
+		std::vector<LoopPosition> expected;
+		for (Y y(0); y <= 2 * height; ++y) {
+			for (X x(0); x <= 2 * width; ++x) {
+				bool is_vertex = (y % 2 == 0 && x % 2 == 0), is_cell = (y % 2 == 1 && x % 2 == 1);
+				if ((kind == 0 && is_vertex) || (kind == 1 && is_cell) || (kind == 2 && !is_vertex && !is_cell)) {
+					expected.push_back(LoopPosition(y, x));
+				}
+			}
+		}
+		assert(field.inspected == expected);
+	}
+}
+void GridLoopPrioritizedQueue()
+{
+	const Y height(3);
+	const X width(4);
+	const LoopPosition first_cell(Y(3), X(5));
+
+	// Positions of vertices (kind = 0), edges (1) or cells (2) in the order of the queue, where <first_cell> is pushed before the others
+	auto positions = [&](int kind) {
+		std::vector<LoopPosition> ret;
+		if (kind == 2) ret.push_back(first_cell);
+		for (Y y(0); y <= 2 * height; ++y) {
+			for (X x(0); x <= 2 * width; ++x) {
+				if (static_cast<int>(y % 2) + static_cast<int>(x % 2) == kind && !(kind == 2 && LoopPosition(y, x) == first_cell)) ret.push_back(LoopPosition(y, x));
+			}
+		}
+		return ret;
+	};
+
+	for (int prioritized = 0; prioritized <= 1; ++prioritized) {
+		InspectRecorder field(height, width);
+		GridLoopMethod method;
+		method.prioritized_queue = (prioritized == 1);
+		field.SetMethod(method);
+
+		field.QueuedRun([&]() {
+			field.CheckAllVertex();
+			field.CheckAllEdge();
+			field.Check(first_cell);
+			field.CheckAllCell();
+		});
+
+		// FIFO order without the option, otherwise cells, edges and then vertices
+		std::vector<LoopPosition> expected;
+		for (int i = 0; i < 3; ++i) {
+			std::vector<LoopPosition> part = positions(prioritized ? 2 - i : i);
+			expected.insert(expected.end(), part.begin(), part.end());
+		}
+		assert(field.inspected == expected);
+	}
 }
 }
+}
\ No newline at end of file
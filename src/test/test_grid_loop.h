@@ -12,5 +12,8 @@ void GridLoopClosedLoop();
 void GridLoopHourglassRule();
 void GridLoopComplexAccessors();
 void GridLoopChainIdentifier();
+void GridLoopRollback();
+void GridLoopCheckAll();
+void GridLoopPrioritizedQueue();
 }
 }
\ No newline at end of file
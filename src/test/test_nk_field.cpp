@@ -7,6 +7,70 @@
 #include "../nurikabe/nk_field.h"
 #include "../nurikabe/nk_problem.h"
 
+namespace
+{
+// A problem generated by GenerateByLocalSearch, with the clue 5 at (2, 4) relaxed so that Solve() doesn't finish it
+penciloid::nurikabe::Problem MakeAssumeTestProblem()
+{
+	using namespace penciloid;
+	using namespace penciloid::nurikabe;
+
+	Problem p(Y(6), X(6));
+	p.SetClue(CellPosition(Y(1), X(1)), Clue(3));
+	p.SetClue(CellPosition(Y(1), X(5)), Clue(3));
+	p.SetClue(CellPosition(Y(2), X(0)), Clue(4));
+	p.SetClue(CellPosition(Y(2), X(4)), Clue(1, 6));
+	return p;
+}
+bool IsSameField(const penciloid::nurikabe::Field &f1, const penciloid::nurikabe::Field &f2)
+{
+	using namespace penciloid;
+
+	if (f1.GetNumberOfDecidedCells() != f2.GetNumberOfDecidedCells()) return false;
+	if (f1.IsInconsistent() != f2.IsInconsistent() || f1.IsFullySolved() != f2.IsFullySolved()) return false;
+	for (Y y(0); y < f1.height(); ++y) {
+		for (X x(0); x < f1.width(); ++x) {
+			if (f1.GetCell(CellPosition(y, x)) != f2.GetCell(CellPosition(y, x))) return false;
+			if (f1.GetClue(CellPosition(y, x)) != f2.GetClue(CellPosition(y, x))) return false;
+		}
+	}
+	return true;
+}
+// Field::Assume() implemented by copying the whole field for each assumption
+void AssumeByCopy(penciloid::nurikabe::Field &field)
+{
+	using namespace penciloid;
+	using namespace penciloid::nurikabe;
+
+	field.Solve();
+	for (;;) {
+		bool progress = false;
+		for (Y y(0); y < field.height(); ++y) {
+			for (X x(0); x < field.width(); ++x) {
+				CellPosition pos(y, x);
+				if (field.GetCell(pos) != Field::kCellUndecided) continue;
+
+				Field assume_black = field, assume_white = field;
+				assume_black.DecideCell(pos, Field::kCellBlack);
+				assume_black.Solve();
+				if (assume_black.IsInconsistent()) {
+					field.DecideCell(pos, Field::kCellWhite);
+					progress = true;
+					continue;
+				}
+				assume_white.DecideCell(pos, Field::kCellWhite);
+				assume_white.Solve();
+				if (assume_white.IsInconsistent()) {
+					field = assume_black;
+					progress = true;
+				}
+			}
+		}
+		if (!progress || field.IsInconsistent() || field.IsFullySolved()) break;
+	}
+}
+}
+
 namespace penciloid
 {
 namespace test
@@ -19,6 +83,8 @@ void RunAllNurikabeFieldTest()
 	NurikabeFieldExpandWhiteTest();
 	NurikabeFieldConsistencyTest();
 	NurikabeFieldCheckReachabilityTest();
+	NurikabeFieldRestorePointTest();
+	NurikabeFieldAssumeTest();
 }
 void NurikabeFieldAdjacentClueTest()
 {
@@ -240,5 +306,48 @@ void NurikabeFieldCheckReachabilityTest()
 		assert(f.IsInconsistent() == false);
 	}
 }
+void NurikabeFieldRestorePointTest()
+{
+	using namespace nurikabe;
+
+	Problem p = MakeAssumeTestProblem();
+	Field f(p);
+	Field original = f;
+
+	f.AddRestorePoint();
+	f.DecideCell(CellPosition(Y(0), X(0)), Field::kCellBlack);
+	f.Solve();
+	Field after_first = f;
+
+	f.AddRestorePoint();
+	f.DecideCell(CellPosition(Y(5), X(5)), Field::kCellWhite);
+	f.Solve();
+	f.Rollback();
+	assert(IsSameField(f, after_first));
+
+	f.Rollback();
+	assert(IsSameField(f, original));
+
+	// Discarded restore points are merged into the previous one
+	f.AddRestorePoint();
+	f.DecideCell(CellPosition(Y(0), X(0)), Field::kCellBlack);
+	f.AddRestorePoint();
+	f.DecideCell(CellPosition(Y(5), X(5)), Field::kCellWhite);
+	f.DiscardRestorePoint();
+	f.Rollback();
+	assert(IsSameField(f, original));
+}
+void NurikabeFieldAssumeTest()
+{
+	using namespace nurikabe;
+
+	Problem p = MakeAssumeTestProblem();
+	Field f(p), f_expected(p);
+	f.Assume();
+	AssumeByCopy(f_expected);
+
+	assert(f.GetNumberOfDecidedCells() > Field(p).GetNumberOfDecidedCells());
+	assert(IsSameField(f, f_expected));
+}
 }
 }
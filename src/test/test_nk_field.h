@@ -10,5 +10,7 @@ void NurikabeFieldExpandBlackTest();
 void NurikabeFieldExpandWhiteTest();
 void NurikabeFieldConsistencyTest();
 void NurikabeFieldCheckReachabilityTest();
+void NurikabeFieldRestorePointTest();
+void NurikabeFieldAssumeTest();
 }
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "test_numberlink_field.h"
+#include "test.h"
+
+#include <cassert>
+
+#include "../numberlink/nl_problem.h"
+#include "../numberlink/nl_field.h"
+
+namespace penciloid
+{
+namespace test
+{
+void RunAllNumberlinkFieldTest()
+{
+	NumberlinkFieldRestoreTest();
+	NumberlinkFieldLargeBoardTest();
+}
+void NumberlinkFieldRestoreTest()
+{
+	using namespace numberlink;
+
+	const char* clues[] = {
+		"1..",
+		"...",
+		"..1",
+	};
+	Problem problem(Y(3), X(3), clues);
+	Field field(problem);
+
+	field.AddRestorePoint();
+	field.SetHorizontalLine(CellPosition(Y(0), X(0)));
+	assert(field.GetHorizontalLine(CellPosition(Y(0), X(0))) == Field::kEdgeLine);
+	assert(field.GetVerticalLine(CellPosition(Y(0), X(0))) == Field::kEdgeBlank);
+	assert(!field.IsInconsistent());
+
+	field.AddRestorePoint();
+	field.SetHorizontalLine(CellPosition(Y(1), X(0)));
+	assert(field.IsInconsistent());
+
+	field.Restore();
+	assert(!field.IsInconsistent());
+	assert(field.GetHorizontalLine(CellPosition(Y(0), X(0))) == Field::kEdgeLine);
+	assert(field.GetHorizontalLine(CellPosition(Y(1), X(0))) != Field::kEdgeLine);
+
+	field.Restore();
+	assert(field.GetHorizontalLine(CellPosition(Y(0), X(0))) == Field::kEdgeUndecided);
+	assert(field.GetVerticalLine(CellPosition(Y(0), X(0))) == Field::kEdgeUndecided);
+	assert(field.IsIsolatedCell(CellPosition(Y(1), X(1))));
+}
+void NumberlinkFieldLargeBoardTest()
+{
+	using namespace numberlink;
+
+	// More changes than the former fixed-size history (10000 entries) could hold
+	const Y height(80);
+	const X width(80);
+	Problem problem(height, width);
+	Field field(problem);
+
+	field.AddRestorePoint();
+	for (Y y(0); y < height; ++y) {
+		for (X x(0); x < width; ++x) {
+			field.SetHorizontalBlank(CellPosition(y, x));
+			field.SetVerticalBlank(CellPosition(y, x));
+		}
+	}
+	assert(!field.IsInconsistent());
+	assert(field.GetHorizontalLine(CellPosition(height / 2, width / 2)) == Field::kEdgeBlank);
+
+	Field copied = field;
+	copied.Restore();
+	field.Restore();
+	for (Y y(0); y < height; ++y) {
+		for (X x(0); x < width; ++x) {
+			assert(field.GetHorizontalLine(CellPosition(y, x)) == (x == width - 1 ? Field::kEdgeBlank : Field::kEdgeUndecided));
+			assert(field.GetVerticalLine(CellPosition(y, x)) == (y == height - 1 ? Field::kEdgeBlank : Field::kEdgeUndecided));
+			assert(copied.GetHorizontalLine(CellPosition(y, x)) == field.GetHorizontalLine(CellPosition(y, x)));
+			assert(copied.GetVerticalLine(CellPosition(y, x)) == field.GetVerticalLine(CellPosition(y, x)));
+		}
+	}
+}
+}
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace penciloid
+{
+namespace test
+{
+void NumberlinkFieldRestoreTest();
+void NumberlinkFieldLargeBoardTest();
+}
+}
\ No newline at end of file
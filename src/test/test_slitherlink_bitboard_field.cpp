@@ -0,0 +1,112 @@
+#include "test_slitherlink_bitboard_field.h"
+#include "test.h"
+
+#include <cassert>
+#include <vector>
+
+#include "../slitherlink/sl_bitboard_field.h"
+#include "../slitherlink/sl_problem.h"
+
+namespace
+{
+// Place clues, propagate and check edges
+void DoBitboardTest(penciloid::Y height, penciloid::X width, std::vector<const char*> test_target)
+{
+	using namespace penciloid;
+	using namespace penciloid::slitherlink;
+
+	Problem problem(height, width);
+	for (Y y(0); y < height; ++y) {
+		for (X x(0); x < width; ++x) {
+			if ('0' <= test_target[y * 2 + 1][x * 2 + 1] && test_target[y * 2 + 1][x * 2 + 1] <= '3') {
+				problem.SetClue(CellPosition(y, x), Clue(test_target[y * 2 + 1][x * 2 + 1] - '0'));
+			}
+		}
+	}
+
+	BitboardField field(problem);
+	field.Propagate();
+	assert(!field.IsInconsistent());
+
+	int n_decided = 0;
+	for (Y y(0); y <= 2 * height; ++y) {
+		for (X x(0); x <= 2 * width; ++x) {
+			if (int(y % 2) != int(x % 2)) {
+				char c = test_target[y][x];
+				assert(field.IsBlank(LoopPosition(y, x)) == (c == 'x'));
+				assert(field.IsLine(LoopPosition(y, x)) == (c != 'x' && c != ' '));
+				if (c != ' ') ++n_decided;
+			}
+		}
+	}
+	assert(field.GetNumberOfDecidedEdges() == n_decided);
+}
+}
+
+namespace penciloid
+{
+namespace test
+{
+void RunAllSlitherlinkBitboardFieldTest()
+{
+	SlitherlinkBitboardFieldPropagate();
+	SlitherlinkBitboardFieldInconsistent();
+	SlitherlinkBitboardFieldMaxWidth();
+}
+void SlitherlinkBitboardFieldPropagate()
+{
+	DoBitboardTest(Y(3), X(3), {
+		"+x+-+ +",
+		"x |    ",
+		"+-+x+ +",
+		"|3x0x  ",
+		"+-+x+ +",
+		"x |    ",
+		"+x+-+ +",
+	});
+	DoBitboardTest(Y(2), X(2), {
+		"+x+x+",
+		"x0x x",
+		"+x+ +",
+		"x    ",
+		"+x+ +",
+	});
+}
+void SlitherlinkBitboardFieldInconsistent()
+{
+	using namespace slitherlink;
+
+	// The line on the top of the 3 has a dead end
+	const char *problem[] = {
+		"30.",
+		"...",
+	};
+	BitboardField field(Problem(Y(2), X(3), problem));
+	field.Propagate();
+	assert(field.IsInconsistent());
+}
+void SlitherlinkBitboardFieldMaxWidth()
+{
+	using namespace slitherlink;
+
+	// The vertices of the rightmost column use the last bit of the words
+	const X width(BitboardField::kMaxWidth);
+	Problem problem(Y(1), width);
+	problem.SetClue(CellPosition(Y(0), width - 1), Clue(0));
+
+	BitboardField field(problem);
+	field.Propagate();
+	assert(!field.IsInconsistent());
+
+	// The edges around the 0 are blank, and so are the horizontal edges next to it (the vertices (0, 62) and (1, 62) have only one undecided edge)
+	const int w = BitboardField::kMaxWidth;
+	assert(field.IsBlank(LoopPosition(Y(0), X(2 * w - 1))));
+	assert(field.IsBlank(LoopPosition(Y(2), X(2 * w - 1))));
+	assert(field.IsBlank(LoopPosition(Y(1), X(2 * w - 2))));
+	assert(field.IsBlank(LoopPosition(Y(1), X(2 * w))));
+	assert(field.IsBlank(LoopPosition(Y(0), X(2 * w - 3))));
+	assert(field.IsBlank(LoopPosition(Y(2), X(2 * w - 3))));
+	assert(field.GetNumberOfDecidedEdges() == 6);
+}
+}
+}
\ No newline at end of file
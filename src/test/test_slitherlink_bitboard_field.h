@@ -0,0 +1,11 @@
+#pragma once
+
+namespace penciloid
+{
+namespace test
+{
+void SlitherlinkBitboardFieldPropagate();
+void SlitherlinkBitboardFieldInconsistent();
+void SlitherlinkBitboardFieldMaxWidth();
+}
+}
\ No newline at end of file
@@ -3,6 +3,30 @@
 
 #include "../slitherlink/sl_dictionary.h"
 
+#include <cstdio>
+#include <cassert>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+// A file name which doesn't collide between concurrent test runs
+std::string TemporaryFilename(const char *base)
+{
+#ifdef _WIN32
+	int pid = _getpid();
+#else
+	int pid = static_cast<int>(getpid());
+#endif
+	return std::string(base) + "_" + std::to_string(pid) + ".bin";
+}
+}
+
 namespace penciloid
 {
 namespace test
@@ -10,6 +34,8 @@ namespace test
 void RunAllSlitherlinkDictionaryTest()
 {
 	SlitherlinkDictionaryRestricted();
+	SlitherlinkDictionaryParallel();
+	SlitherlinkDictionarySaveLoad();
 }
 void SlitherlinkDictionaryRestricted()
 {
@@ -27,5 +53,87 @@ void SlitherlinkDictionaryRestricted()
 		}
 	}
 }
+void SlitherlinkDictionaryParallel()
+{
+	using namespace slitherlink;
+	DictionaryMethod method;
+	method.line_from_clue_3 = false;
+
+	// The threaded creation gives the same dictionary as the serial one
+	Dictionary dic_serial, dic_threaded, dic_default_serial, dic_default_threaded;
+	dic_serial.CreateRestricted(method);
+	dic_threaded.CreateRestricted(method, 3);
+	dic_default_serial.CreateDefault();
+	dic_default_threaded.CreateDefault(3);
+
+	for (int i = 0; i < 531441; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			assert(dic_serial.Get(i, j) == dic_threaded.Get(i, j));
+			assert(dic_default_serial.Get(i, j) == dic_default_threaded.Get(i, j));
+		}
+	}
+}
+void SlitherlinkDictionarySaveLoad()
+{
+	using namespace slitherlink;
+	std::string filename = TemporaryFilename("penciloid_test_dictionary");
+
+	DictionaryMethod method;
+	method.corner_clue_2_hard = false;
+
+	Dictionary dic_created, dic_parallel, dic_loaded;
+	dic_created.CreateRestricted(method);
+	dic_parallel.CreateRestricted(method, 2);
+	bool saved = dic_created.Save(filename);
+	assert(saved);
+
+	bool loaded_other_method = dic_loaded.Load(filename, DictionaryMethod());
+	assert(!loaded_other_method);
+	bool loaded = dic_loaded.Load(filename, method);
+	assert(loaded);
+	for (int i = 0; i < 531441; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			assert(dic_created.Get(i, j) == dic_parallel.Get(i, j));
+			assert(dic_created.Get(i, j) == dic_loaded.Get(i, j));
+		}
+	}
+
+	dic_loaded.Release();
+
+	{
+		// A file whose last entry indexes no result is rejected
+		std::string corrupt_filename = TemporaryFilename("penciloid_test_dictionary_corrupt");
+		FILE *in = fopen(filename.c_str(), "rb");
+		FILE *out = fopen(corrupt_filename.c_str(), "wb");
+		assert(in && out);
+		std::vector<char> content;
+		for (int c; (c = fgetc(in)) != EOF;) content.push_back(static_cast<char>(c));
+		content[content.size() - 1] = content[content.size() - 2] = static_cast<char>(0xff);
+		fwrite(content.data(), 1, content.size(), out);
+		fclose(in);
+		fclose(out);
+		bool loaded_corrupt = dic_loaded.Load(corrupt_filename, method);
+		assert(!loaded_corrupt);
+		std::remove(corrupt_filename.c_str());
+	}
+
+	std::remove(filename.c_str());
+	bool loaded_removed = dic_loaded.Load(filename, method);
+	assert(!loaded_removed);
+
+	// The file is missing, so LoadOrCreate creates the dictionary in parallel and saves it
+	Dictionary dic_load_or_create;
+	dic_load_or_create.LoadOrCreate(filename, method, 3);
+	loaded = dic_loaded.Load(filename, method);
+	assert(loaded);
+	for (int i = 0; i < 531441; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			assert(dic_created.Get(i, j) == dic_load_or_create.Get(i, j));
+			assert(dic_created.Get(i, j) == dic_loaded.Get(i, j));
+		}
+	}
+	dic_loaded.Release();
+	std::remove(filename.c_str());
+}
 }
 }
\ No newline at end of file
@@ -7,5 +7,7 @@ namespace penciloid
 namespace test
 {
 void SlitherlinkDictionaryRestricted();
+void SlitherlinkDictionaryParallel();
+void SlitherlinkDictionarySaveLoad();
 }
 }
\ No newline at end of file
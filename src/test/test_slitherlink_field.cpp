@@ -6,6 +6,9 @@
 
 #include "../slitherlink/sl_field.h"
 #include "../slitherlink/sl_dictionary.h"
+#include "../common/grid_loop_helper.h"
+#include "../common/grid_loop_lookahead.h"
+#include "../common/thread_pool.h"
 
 namespace
 {
@@ -48,19 +51,23 @@ void DoProblemTest(penciloid::Y height, penciloid::X width, std::vector<const ch
 	using namespace penciloid;
 	using namespace penciloid::slitherlink;
 
-	Field field(height, width);
-	field.SetDatabase(db);
+	// The problem should be solved regardless of the order of the propagation
+	for (int prioritized = 0; prioritized <= 1; ++prioritized) {
+		Method method;
+		method.grid_loop_method.prioritized_queue = (prioritized == 1);
+		Field field(height, width, db, method);
 
-	for (Y y(0); y < height; ++y) {
-		for (X x(0); x < width; ++x) {
-			if ('0' <= test_problem[y][x] && test_problem[y][x] <= '3') {
-				field.AddClue(CellPosition(y, x), Clue(test_problem[y][x] - '0'));
+		for (Y y(0); y < height; ++y) {
+			for (X x(0); x < width; ++x) {
+				if ('0' <= test_problem[y][x] && test_problem[y][x] <= '3') {
+					field.AddClue(CellPosition(y, x), Clue(test_problem[y][x] - '0'));
+				}
 			}
 		}
-	}
 
-	assert(field.IsInconsistent() == false);
-	assert(field.IsFullySolved() == true);
+		assert(field.IsInconsistent() == false);
+		assert(field.IsFullySolved() == true);
+	}
 }
 }
 
@@ -80,6 +87,11 @@ void RunAllSlitherlinkFieldTest()
 	SlitherlinkFieldFullySolvableProblem(db);
 	SlitherlinkFieldSolveProblem(db);
 	SlitherlinkFieldDiagonalChain(db);
+	SlitherlinkFieldTrial(db);
+	SlitherlinkFieldRemoveClue(db);
+	SlitherlinkFieldPairTable();
+	SlitherlinkFieldAssumeVariants(db);
+	SlitherlinkFieldLookahead(db);
 }
 void SlitherlinkFieldAddClue(penciloid::slitherlink::Dictionary &db)
 {
@@ -303,5 +315,310 @@ void SlitherlinkFieldDiagonalChain(penciloid::slitherlink::Dictionary &db)
 		"+ + + + +",
 	}, &db);
 }
+void SlitherlinkFieldTrial(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	const char* problem_base[] = {
+		"3-3",
+		"---",
+		"---",
+	};
+	Problem problem(Y(3), X(3), problem_base);
+	Field field(problem, &db);
+	Field::EdgeCount decided_edges = field.GetNumberOfDecidedEdges();
+	unsigned long long clue_hash = field.GetClueHash();
+
+	field.BeginTrial();
+	field.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+	assert(field.GetClue(CellPosition(Y(2), X(2))) == 0);
+	assert(field.GetEdge(LoopPosition(Y(5), X(6))) == Field::kEdgeBlank);
+
+	// nested trial causing inconsistency
+	field.BeginTrial();
+	field.AddClue(CellPosition(Y(2), X(1)), Clue(3));
+	field.AddClue(CellPosition(Y(1), X(1)), Clue(0));
+	field.AddClue(CellPosition(Y(1), X(2)), Clue(0));
+	assert(field.IsInconsistent());
+	field.AbortTrial();
+	assert(!field.IsInconsistent());
+	assert(field.GetClue(CellPosition(Y(2), X(1))) == kNoClue);
+	assert(field.GetClue(CellPosition(Y(2), X(2))) == 0);
+
+	field.AbortTrial();
+	assert(field.GetClue(CellPosition(Y(2), X(2))) == kNoClue);
+	assert(field.GetEdge(LoopPosition(Y(5), X(6))) == Field::kEdgeUndecided);
+	assert(field.GetNumberOfDecidedEdges() == decided_edges);
+	assert(field.GetClueHash() == clue_hash);
+
+	field.BeginTrial();
+	field.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+	field.CommitTrial();
+	Field expected(problem, &db);
+	expected.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+	assert(field.GetNumberOfDecidedEdges() == expected.GetNumberOfDecidedEdges());
+	assert(field.GetClueHash() == expected.GetClueHash());
+	for (Y y(0); y <= 6; ++y) {
+		for (X x(0); x <= 6; ++x) {
+			if (static_cast<int>(y % 2) != static_cast<int>(x % 2)) {
+				assert(field.GetEdge(LoopPosition(y, x)) == expected.GetEdge(LoopPosition(y, x)));
+			}
+		}
+	}
+}
+void SlitherlinkFieldRemoveClue(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	const char* problem_base[] = {
+		"3---",
+		"----",
+		"----",
+		"---3",
+	};
+	Problem problem(Y(4), X(4), problem_base);
+	Field field(problem, &db);
+	field.EnableClueRemoval(8);
+	field.AddClue(CellPosition(Y(1), X(1)), Clue(2));
+	field.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+	field.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+
+	auto check = [&](const Field &expected) {
+		assert(field.IsInconsistent() == expected.IsInconsistent());
+		assert(field.GetNumberOfDecidedEdges() == expected.GetNumberOfDecidedEdges());
+		assert(field.GetClueHash() == expected.GetClueHash());
+		for (Y y(0); y <= 8; ++y) {
+			for (X x(0); x <= 8; ++x) {
+				if (static_cast<int>(y % 2) != static_cast<int>(x % 2)) {
+					assert(field.GetEdge(LoopPosition(y, x)) == expected.GetEdge(LoopPosition(y, x)));
+				}
+			}
+		}
+	};
+
+	// undo a removal, including the history used by the next removal
+	{
+		Field before(field);
+		Field::ClueRemoval removal;
+		field.RemoveClue(CellPosition(Y(1), X(1)), nullptr, &removal);
+		field.BeginTrial();
+		field.AddClue(CellPosition(Y(1), X(1)), Clue(3));
+		field.AbortTrial();
+		field.UndoRemoveClue(&removal);
+		assert(field.GetClue(CellPosition(Y(1), X(1))) == 2);
+		check(before);
+	}
+
+	// remove a clue added in the middle
+	field.RemoveClue(CellPosition(Y(2), X(2)));
+	assert(field.GetClue(CellPosition(Y(2), X(2))) == kNoClue);
+	{
+		Field expected(problem, &db);
+		expected.AddClue(CellPosition(Y(1), X(1)), Clue(2));
+		expected.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+		check(expected);
+	}
+
+	// remove a clue of the original problem
+	field.RemoveClue(CellPosition(Y(0), X(0)));
+	assert(field.GetClue(CellPosition(Y(0), X(0))) == kNoClue);
+	assert(field.GetClue(CellPosition(Y(1), X(2))) == 1);
+	{
+		problem.SetClue(CellPosition(Y(0), X(0)), kNoClue);
+		Field expected(problem, &db);
+		expected.AddClue(CellPosition(Y(1), X(1)), Clue(2));
+		expected.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+		check(expected);
+	}
+
+	// the deductions of <propagate> are made again after the replay
+	{
+		field = Field(problem, &db);
+		field.EnableClueRemoval(8);
+		field.AddClue(CellPosition(Y(1), X(1)), Clue(2));
+		field.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+		field.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+		int n_propagations = 0;
+		field.RemoveClue(CellPosition(Y(1), X(1)), [&](Field &f) { ++n_propagations; Assume(&f); });
+		assert(n_propagations == 1);
+
+		Field expected(problem, &db);
+		expected.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+		expected.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+		Assume(&expected);
+		check(expected);
+	}
+
+	// the oldest frames beyond the bound are merged, and their clues are removed by the recomputation
+	{
+		field = Field(problem, &db);
+		field.EnableClueRemoval(1);
+		field.AddClue(CellPosition(Y(1), X(1)), Clue(2));
+		field.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+		field.RemoveClue(CellPosition(Y(1), X(1)));
+		assert(field.GetClue(CellPosition(Y(1), X(2))) == 1);
+
+		Field expected(problem, &db);
+		expected.AddClue(CellPosition(Y(1), X(2)), Clue(1));
+		check(expected);
+
+		// undo a recomputation
+		Field::ClueRemoval removal;
+		field.RemoveClue(CellPosition(Y(1), X(2)), nullptr, &removal);
+		assert(field.GetClue(CellPosition(Y(1), X(2))) == kNoClue);
+		field.UndoRemoveClue(&removal);
+		check(expected);
+
+		// the frame bound is kept by the recomputed field
+		field.AddClue(CellPosition(Y(2), X(2)), Clue(0));
+		field.RemoveClue(CellPosition(Y(2), X(2)));
+		check(expected);
+	}
+
+	// a clue recorded in a trial without any frame: the field is recomputed
+	{
+		problem.SetClue(CellPosition(Y(0), X(0)), Clue(3));
+		field = Field(problem, &db);
+		field.BeginTrial();
+		field.AddClue(CellPosition(Y(1), X(1)), Clue(2));
+		field.RemoveClue(CellPosition(Y(1), X(1)));
+		assert(field.GetClue(CellPosition(Y(1), X(1))) == kNoClue);
+		check(Field(problem, &db));
+	}
+}
+void SlitherlinkFieldPairTable()
+{
+	using namespace slitherlink;
+
+	Dictionary db;
+	db.CreateDefault();
+	db.CreatePairTable();
+
+	DoAddClueTest(Y(3), X(3), {
+		"+x+x+x+",
+		"x x1x1x",
+		"+x+-+-+",
+		"x | x |",
+		"+x+-+ +",
+		"x0x    ",
+		"+x+x+ +",
+	}, &db);
+}
+void SlitherlinkFieldAssumeVariants(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	// A problem from SlitherlinkFieldSolveProblem with some clues removed, so that Assume has some work
+	const char *problem[] = {
+		"1-33---1-1",
+		"-3--1-3---",
+		"------0-1-",
+		"3-31-----0",
+		"-2---0----",
+		"----1---3-",
+		"3-----01-3",
+		"-0-3------",
+		"---0-3--2-",
+		"1-3---02-1"
+	};
+	Field field(Y(10), X(10), &db);
+	for (Y y(0); y < 10; ++y) {
+		for (X x(0); x < 10; ++x) {
+			if ('0' <= problem[y][x] && problem[y][x] <= '3' && (static_cast<int>(y) + static_cast<int>(x)) % 4 != 0) {
+				field.AddClue(CellPosition(y, x), Clue(problem[y][x] - '0'));
+			}
+		}
+	}
+
+	Field field_sequential = field, field_parallel = field, field_incremental = field;
+	ThreadPool pool(3);
+	Assume(&field_sequential);
+	Assume(&field_parallel, &pool);
+	AssumeIncremental(&field_incremental);
+
+	assert(field_sequential.GetNumberOfDecidedEdges() > field.GetNumberOfDecidedEdges());
+	assert(field_sequential.IsInconsistent() == field_parallel.IsInconsistent());
+	assert(field_sequential.IsInconsistent() == field_incremental.IsInconsistent());
+	for (Y y(0); y <= 20; ++y) {
+		for (X x(0); x <= 20; ++x) {
+			if (int(y % 2) != int(x % 2)) {
+				assert(field_sequential.GetEdge(LoopPosition(y, x)) == field_parallel.GetEdge(LoopPosition(y, x)));
+				assert(field_sequential.GetEdge(LoopPosition(y, x)) == field_incremental.GetEdge(LoopPosition(y, x)));
+			}
+		}
+	}
+}
+void SlitherlinkFieldLookahead(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	// The problem of SlitherlinkFieldAssumeVariants with a different set of clues removed
+	const char *problem[] = {
+		"1-33---1-1",
+		"-3--1-3---",
+		"------0-1-",
+		"3-31-----0",
+		"-2---0----",
+		"----1---3-",
+		"3-----01-3",
+		"-0-3------",
+		"---0-3--2-",
+		"1-3---02-1"
+	};
+	Field field(Y(10), X(10), &db);
+	for (Y y(0); y < 10; ++y) {
+		for (X x(0); x < 10; ++x) {
+			if ('0' <= problem[y][x] && problem[y][x] <= '3' && (static_cast<int>(y) + static_cast<int>(x)) % 5 != 4) {
+				field.AddClue(CellPosition(y, x), Clue(problem[y][x] - '0'));
+			}
+		}
+	}
+
+	Field field_assume = field;
+	Assume(&field_assume);
+
+	// Both are sound, so they never decide an edge differently
+	auto check_agreement = [](const Field &field1, const Field &field2, bool exact) {
+		for (Y y(0); y <= 20; ++y) {
+			for (X x(0); x <= 20; ++x) {
+				if (int(y % 2) == int(x % 2)) continue;
+				Field::EdgeState edge1 = field1.GetEdge(LoopPosition(y, x)), edge2 = field2.GetEdge(LoopPosition(y, x));
+				if (exact) assert(edge1 == edge2);
+				else assert(edge1 == Field::kEdgeUndecided || edge2 == Field::kEdgeUndecided || edge1 == edge2);
+			}
+		}
+	};
+
+	{
+		// Depth 1 is the same as Assume
+		Field field_depth1 = field;
+		LookaheadResult result = Lookahead(&field_depth1, LookaheadOption());
+		check_agreement(field_assume, field_depth1, true);
+		assert(result.depth_required == 1);
+		assert(result.n_probes > 0);
+		assert(!result.budget_exhausted);
+	}
+	{
+		Field field_depth2 = field;
+		LookaheadOption option;
+		option.depth = 2;
+		option.ordering = LookaheadOption::kOrderDecidedNeighbors;
+		LookaheadResult result = Lookahead(&field_depth2, option);
+		assert(!field_depth2.IsInconsistent());
+		assert(field_depth2.GetNumberOfDecidedEdges() > field_assume.GetNumberOfDecidedEdges());
+		check_agreement(field_assume, field_depth2, false);
+		assert(result.depth_required == 2);
+	}
+	{
+		Field field_limited = field;
+		LookaheadOption option;
+		option.depth = 2;
+		option.max_probes = 10;
+		LookaheadResult result = Lookahead(&field_limited, option);
+		check_agreement(field_assume, field_limited, false);
+		assert(result.n_probes == 10);
+		assert(result.budget_exhausted);
+	}
+}
 }
 }
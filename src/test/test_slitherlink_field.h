@@ -11,5 +11,10 @@ void SlitherlinkFieldTheorem(penciloid::slitherlink::Dictionary &db);
 void SlitherlinkFieldFullySolvableProblem(penciloid::slitherlink::Dictionary &db);
 void SlitherlinkFieldSolveProblem(penciloid::slitherlink::Dictionary &db);
 void SlitherlinkFieldDiagonalChain(penciloid::slitherlink::Dictionary &db);
+void SlitherlinkFieldTrial(penciloid::slitherlink::Dictionary &db);
+void SlitherlinkFieldRemoveClue(penciloid::slitherlink::Dictionary &db);
+void SlitherlinkFieldPairTable();
+void SlitherlinkFieldAssumeVariants(penciloid::slitherlink::Dictionary &db);
+void SlitherlinkFieldLookahead(penciloid::slitherlink::Dictionary &db);
 }
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "test_slitherlink_generator.h"
+#include "test.h"
+
+#include <cassert>
+#include <random>
+
+#include "../slitherlink/sl_generator.h"
+#include "../slitherlink/sl_generator_option.h"
+#include "../slitherlink/sl_clue_placement.h"
+#include "../slitherlink/sl_problem.h"
+#include "../slitherlink/sl_dictionary.h"
+
+namespace penciloid
+{
+namespace test
+{
+void RunAllSlitherlinkGeneratorTest()
+{
+	slitherlink::Dictionary db;
+	db.CreateDefault();
+
+	SlitherlinkGeneratorThreadIndependent(db);
+}
+void SlitherlinkGeneratorThreadIndependent(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	const Y height(6);
+	const X width(6);
+	for (bool use_assumption : { false, true }) {
+		for (int seed = 0; seed < 4; ++seed) {
+			std::mt19937 rnd_placement(seed);
+			CluePlacement placement = GenerateCluePlacement(height, width, 14, kSymmetryDyad, &rnd_placement);
+
+			// The same seed gives the same result with 1 and 3 threads (and with the parallel trial-and-error technique)
+			Problem results[2];
+			bool generated[2];
+			for (int k = 0; k < 2; ++k) {
+				GeneratorOption option;
+				option.field_dictionary = &db;
+				option.use_assumption = use_assumption;
+				option.n_evaluation_threads = k == 0 ? 1 : 3;
+				option.n_assumption_threads = k == 0 ? 2 : 1;
+				std::mt19937 rnd(seed);
+				generated[k] = GenerateByLocalSearch(placement, option, &rnd, &results[k]);
+			}
+			assert(generated[0] == generated[1]);
+			if (!generated[0]) continue;
+			for (Y y(0); y < height; ++y) {
+				for (X x(0); x < width; ++x) {
+					assert(results[0].GetClue(CellPosition(y, x)) == results[1].GetClue(CellPosition(y, x)));
+				}
+			}
+		}
+	}
+}
+}
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../slitherlink/sl_dictionary.h"
+
+namespace penciloid
+{
+namespace test
+{
+void SlitherlinkGeneratorThreadIndependent(penciloid::slitherlink::Dictionary &db);
+}
+}
\ No newline at end of file
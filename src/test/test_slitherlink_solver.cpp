@@ -0,0 +1,143 @@
+#include "test_slitherlink_solver.h"
+#include "test.h"
+
+#include <cassert>
+
+#include "../slitherlink/sl_solver.h"
+#include "../slitherlink/sl_problem.h"
+#include "../slitherlink/sl_field.h"
+#include "../slitherlink/sl_dictionary.h"
+#include "../slitherlink/sl_dictionary_method.h"
+
+namespace
+{
+// A problem from SlitherlinkFieldSolveProblem (which has the unique solution)
+const char *kProblem[] = {
+	"1-33---1-1",
+	"-3--1-3---",
+	"------0-1-",
+	"3-31-----0",
+	"-2---0----",
+	"----1---3-",
+	"3-----01-3",
+	"-0-3------",
+	"---0-3--2-",
+	"1-3---02-1"
+};
+// Check that <solution> is fully solved and satisfies all the clues of <problem>
+void CheckSolution(penciloid::slitherlink::Problem &problem, const penciloid::slitherlink::Field &solution)
+{
+	using namespace penciloid;
+	using namespace penciloid::slitherlink;
+
+	assert(solution.IsFullySolved());
+	assert(!solution.IsInconsistent());
+	for (Y y(0); y < problem.height(); ++y) {
+		for (X x(0); x < problem.width(); ++x) {
+			Clue clue = problem.GetClue(CellPosition(y, x));
+			if (clue == kNoClue) continue;
+			LoopPosition center(y * 2 + 1, x * 2 + 1);
+			int n_lines = 0;
+			if (solution.GetEdge(center + Direction(Y(-1), X(0))) == Field::kEdgeLine) ++n_lines;
+			if (solution.GetEdge(center + Direction(Y(1), X(0))) == Field::kEdgeLine) ++n_lines;
+			if (solution.GetEdge(center + Direction(Y(0), X(-1))) == Field::kEdgeLine) ++n_lines;
+			if (solution.GetEdge(center + Direction(Y(0), X(1))) == Field::kEdgeLine) ++n_lines;
+			assert(n_lines == clue);
+		}
+	}
+}
+}
+namespace penciloid
+{
+namespace test
+{
+void RunAllSlitherlinkSolverTest()
+{
+	slitherlink::Dictionary db;
+	db.CreateDefault();
+
+	SlitherlinkSolverUnique();
+	SlitherlinkSolverMultipleSolutions(db);
+	SlitherlinkSolverNoSolution(db);
+}
+void SlitherlinkSolverUnique()
+{
+	using namespace slitherlink;
+
+	// The propagation with weaker methods doesn't finish the problem
+	DictionaryMethod dictionary_method;
+	dictionary_method.corner_clue_2 = false;
+	dictionary_method.corner_clue_2_hard = false;
+	dictionary_method.line_to_clue_1 = dictionary_method.line_to_clue_2 = dictionary_method.line_to_clue_3 = false;
+	dictionary_method.partial_line_to_clue_2 = false;
+	dictionary_method.line_from_clue_1 = dictionary_method.line_from_clue_3 = false;
+	Dictionary db_restricted;
+	db_restricted.CreateRestricted(dictionary_method);
+	Method method;
+	method.adjacent_3 = method.diagonal_3 = method.diagonal_chain = false;
+
+	Problem problem(Y(10), X(10), kProblem);
+	assert(!Field(problem, &db_restricted, method).IsFullySolved());
+
+	for (int n_threads = 1; n_threads <= 3; n_threads += 2) {
+		for (bool use_assumption : { false, true }) {
+			SolverOption option;
+			option.n_threads = n_threads;
+			option.use_assumption = use_assumption;
+			Solver solver(&db_restricted, method, option);
+			assert(solver.Solve(problem) == 1);
+			assert(solver.IsUnique());
+			CheckSolution(problem, solver.GetSolution(0));
+		}
+	}
+}
+void SlitherlinkSolverMultipleSolutions(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	Problem problem(Y(10), X(10), kProblem);
+	for (Y y(0); y < 10; ++y) {
+		for (X x(0); x < 10; ++x) {
+			if ((static_cast<int>(y) + static_cast<int>(x)) % 4 == 0) problem.SetClue(CellPosition(y, x), kNoClue);
+		}
+	}
+	for (int n_threads = 1; n_threads <= 3; n_threads += 2) {
+		SolverOption option;
+		option.n_threads = n_threads;
+		Solver solver(&db, Method(), option);
+		assert(solver.Solve(problem) == 2);
+		assert(!solver.IsUnique());
+		CheckSolution(problem, solver.GetSolution(0));
+		CheckSolution(problem, solver.GetSolution(1));
+	}
+	{
+		// The search is aborted by the limit of nodes
+		SolverOption option;
+		option.max_nodes = 1;
+		option.use_assumption = false;
+		Solver solver(&db, Method(), option);
+		solver.Solve(problem);
+		assert(solver.IsAborted());
+		assert(!solver.IsUnique());
+	}
+}
+void SlitherlinkSolverNoSolution(penciloid::slitherlink::Dictionary &db)
+{
+	using namespace slitherlink;
+
+	// The loop around a single cell has 4 lines
+	Problem problem(Y(1), X(1));
+	problem.SetClue(CellPosition(Y(0), X(0)), Clue(3));
+	Solver solver(&db);
+	assert(solver.Solve(problem) == 0);
+	assert(!solver.IsAborted());
+
+	// No loop at all
+	Problem problem_zero(Y(2), X(2));
+	for (Y y(0); y < 2; ++y) {
+		for (X x(0); x < 2; ++x) problem_zero.SetClue(CellPosition(y, x), Clue(0));
+	}
+	assert(solver.Solve(problem_zero) == 0);
+}
+}
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../slitherlink/sl_dictionary.h"
+
+namespace penciloid
+{
+namespace test
+{
+void SlitherlinkSolverUnique();
+void SlitherlinkSolverMultipleSolutions(penciloid::slitherlink::Dictionary &db);
+void SlitherlinkSolverNoSolution(penciloid::slitherlink::Dictionary &db);
+}
+}
\ No newline at end of file